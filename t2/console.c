@@ -481,9 +481,31 @@ char console_processa_entrada(console_t *self)
 }
 
 void console_tictac(console_t *self)
+{
+  console_avanca(self, 1);
+}
+
+void console_avanca(console_t *self, int n)
 {
   verifica_entrada(self);
-  rola_saidas(self);
+  // cada passo move um caractere em cada saída rolando ou limpando; depois
+  //   que todas voltam ao normal, os outros passos não mudam nada
+  for (int i = 0; i < n; i++)
+  {
+    bool ocupado = false;
+    for (int t = 0; t < N_TERM; t++)
+    {
+      if (self->term[t].estado_saida != normal)
+      {
+        ocupado = true;
+      }
+    }
+    if (!ocupado)
+    {
+      break;
+    }
+    rola_saidas(self);
+  }
 }
 
 void console_atualiza(console_t *self)
@@ -37,6 +37,10 @@ char console_processa_entrada(console_t *self);
 // esta função deve ser chamada periodicamente para que tela funcione
 void console_tictac(console_t *self);
 
+// o mesmo que 'n' chamadas a console_tictac, com a entrada verificada uma
+//   vez só
+void console_avanca(console_t *self, int n);
+
 // esta função deve ser chamada para desenhar a tela da console
 void console_atualiza(console_t *self);
 
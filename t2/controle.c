@@ -4,6 +4,10 @@
 #include <string.h>
 #include <stdio.h>
 
+// número máximo de instruções executadas pela CPU a cada volta do laço
+//   principal; o lote é encurtado para terminar no próximo evento do relógio
+#define MAX_INSTR_POR_LOTE 1000
+
 struct controle_t {
   cpu_t *cpu;
   relogio_t *relogio;
@@ -14,6 +18,7 @@ struct controle_t {
 // funções auxiliares
 static void controle_processa_teclado(controle_t *self);
 static void controle_atualiza_console(controle_t *self);
+static int controle_tam_lote(controle_t *self);
 
 
 controle_t *controle_cria(cpu_t *cpu, console_t *console, relogio_t *relogio)
@@ -36,12 +41,19 @@ void controle_destroi(controle_t *self)
 
 void controle_laco(controle_t *self)
 {
-  // executa uma instrução por vez até a console dizer que chega
+  // executa um lote de instruções por vez até a console dizer que chega
   do {
     if (self->estado == passo || self->estado == executando) {
-      cpu_executa_1(self->cpu);
-      rel_tictac(self->relogio);
-      console_tictac(self->console);
+      int lote = controle_tam_lote(self);
+      int feitas = cpu_executa_n(self->cpu, lote);
+      // se a CPU parou antes do fim do lote, o tempo continua passando até
+      //   o fim dele, como se tivesse executado cpu_executa_1 sem efeito
+      //   (o lote termina no máximo na próxima interrupção do relógio)
+      if (feitas < lote) feitas = lote;
+      rel_avanca(self->relogio, feitas);
+      // a console anda o mesmo tempo, para que a rolagem e a limpeza das
+      //   saídas dos terminais levem o mesmo número de instruções
+      console_avanca(self->console, feitas);
       // enquanto não tem controlador de interrupção, fala direto com o relógio
       // o dispositivo 3 do relógio contém 1 se o timer expirou
       int tem_int;
@@ -59,6 +71,22 @@ void controle_laco(controle_t *self)
 }
  
 
+// calcula quantas instruções executar de uma vez, sem passar do próximo
+//   evento do relógio, para que a interrupção aconteça na mesma instrução
+//   que aconteceria executando uma por vez
+static int controle_tam_lote(controle_t *self)
+{
+  if (self->estado == passo) return 1;
+  int tem_int, t_ate_int;
+  // uma interrupção pendente e ainda não aceita pela CPU (em modo supervisor)
+  //   é testada de novo após cada instrução
+  rel_le(self->relogio, 3, &tem_int);
+  if (tem_int != 0) return 1;
+  rel_le(self->relogio, 2, &t_ate_int);
+  if (t_ate_int > 0 && t_ate_int < MAX_INSTR_POR_LOTE) return t_ate_int;
+  return MAX_INSTR_POR_LOTE;
+}
+
 static void controle_processa_teclado(controle_t *self)
 {
   if (self->estado == passo) self->estado = parado;
@@ -1,10 +1,100 @@
 #include "cpu.h"
 #include "instrucao.h"
+#ifdef CPU_JIT
+#include "jit.h"
+#endif
 
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#ifdef CPU_PERFIL
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+#endif
+
+#if defined(CPU_JIT) && defined(CPU_DESPACHO_DIRETO)
+#error "o JIT só funciona com o despacho por switch"
+#endif
+
+#ifdef CPU_PERFIL
+// linhas da tabela do perfil de execução: uma para cada opcode, mais estas
+enum {
+  PERFIL_FUSAO = CHAMAS + 1,  // sequências de instruções fundidas
+  PERFIL_INVALIDA,            // instruções com opcode inválido
+  PERFIL_TRADUZIDO,           // chamadas ao código traduzido
+  PERFIL_JIT,                 // chamadas ao JIT
+  N_PERFIL
+};
+#endif
+
+// número de entradas na cache de instruções pré-decodificadas
+// tem que ser potência de 2
+#define TAM_CACHE_INSTR 4096
+
+// sequências de instruções reconhecidas na decodificação e executadas
+//   de uma vez (superinstruções)
+typedef enum {
+  SEM_FUSAO,
+  FUS_CARGM_SOMA_ARMM,         // expressões a = b + c
+  FUS_CPXA_RESTO_DESVNZ,       // teste de divisibilidade do contador em X
+  FUS_TRAX_ARMM_CARGI_CHAMAS,  // prólogo de impch
+  FUS_CARGX_DESVZ,             // laço de impstr
+  N_FUSAO
+} fusao_t;
+
+// número máximo de instruções e de palavras de memória em uma fusão
+#define MAX_INSTR_FUSAO 4
+#define MAX_PALAVRAS_FUSAO 6
+
+static struct {
+  char *nome;
+  int n_instr;
+  opcode_t opcode[MAX_INSTR_FUSAO];
+} fusoes[N_FUSAO] = {
+  [FUS_CARGM_SOMA_ARMM]        = { "CARGM/SOMA/ARMM",        3,
+                                   { CARGM, SOMA, ARMM } },
+  [FUS_CPXA_RESTO_DESVNZ]      = { "CPXA/RESTO/DESVNZ",      3,
+                                   { CPXA, RESTO, DESVNZ } },
+  [FUS_TRAX_ARMM_CARGI_CHAMAS] = { "TRAX/ARMM/CARGI/CHAMAS", 4,
+                                   { TRAX, ARMM, CARGI, CHAMAS } },
+  [FUS_CARGX_DESVZ]            = { "CARGX/DESVZ",            2,
+                                   { CARGX, DESVZ } },
+};
+
+// variantes do interpretador, especializadas para cada modo de execução
+// a variante é escolhida quando o modo muda (na interrupção e no retorno
+//   dela); a tabela de páginas só é trocada pelo SO, em modo supervisor,
+//   então já está definida quando o modo usuário começa
+typedef enum {
+  VAR_SUPERVISOR,        // modo supervisor, acessa a memória física
+  VAR_USUARIO_FISICO,    // modo usuário sem tabela de páginas
+  VAR_USUARIO_PAGINADO,  // modo usuário com tradução pela tabela de páginas
+  N_VARIANTE
+} variante_t;
+
+// uma instrução pré-decodificada, guardada na cache de instruções
+// a cache é indexada pelo endereço físico da instrução, e a entrada é
+//   descartada quando a memória é alterada em alguma das palavras que
+//   ela cobre
+// o argumento só é guardado se estiver na mesma página que o opcode, e
+//   portanto no quadro seguinte ao do opcode em memória física
+// se a instrução inicia uma sequência que pode ser fundida, a entrada
+//   cobre a sequência toda (que também tem que estar inteira no quadro),
+//   e tem o argumento de cada instrução dela
+typedef struct {
+  int end;      // endereço físico da instrução, -1 se a entrada é inválida
+  int tam;      // número de palavras cobertas pela entrada
+  int opcode;
+  int A1;
+  bool tem_A1;  // se A1 foi lido da memória junto com o opcode
+  fusao_t fusao;
+  int arg_fusao[MAX_INSTR_FUSAO];
+} instr_decod_t;
 
 // uma CPU tem estado, memória, controlador de ES
 struct cpu_t {
@@ -18,18 +108,110 @@ struct cpu_t {
   cpu_modo_t modo;
   // acesso a dispositivos externos
   mmu_t *mmu;
+  mem_t *mem;
   es_t *es;
+  // variante do interpretador para o modo atual
+  variante_t variante;
   // função e argumento para implementar instrução CHAMAC
   func_chamaC_t funcaoC;
   void *argC;
+  // estado salvo na interrupção (banco de registradores sombra), se não
+  //   for salvo na memória, e se a interrupção chama funcaoC diretamente
+  cpu_estado_t salvo;
+  bool estado_em_memoria;
+  bool interrupcao_direta;
+  // argumento da instrução em execução, se veio da cache de instruções
+  int A1;
+  bool tem_A1;
+  // entrada da cache com a instrução em execução
+  instr_decod_t *instr;
+  // cache de instruções pré-decodificadas
+  instr_decod_t cache_instr[TAM_CACHE_INSTR];
+  // número de vezes que cada fusão foi executada
+  long n_fusoes[N_FUSAO];
+#ifdef CPU_PERFIL
+  // perfil de execução (ver cpu_relatorio)
+  struct {
+    long n[N_PERFIL];           // execuções de cada linha
+    uint64_t tempo[N_PERFIL];   // tempo gasto em cada linha
+    int linha;                  // linha em execução, e quando ela começou
+    uint64_t inicio_linha;
+    uint64_t tempo_cpu;         // tempo dentro de cpu_executa_n
+    uint64_t inicio;            // quando a CPU foi criada
+    long n_traducoes;           // traduções de endereço pela MMU
+    long n_falhas;              // acessos à memória com erro
+    long n_interrupcoes[N_IRQ]; // interrupções aceitas
+    long n_buscas;              // instruções buscadas pelo interpretador
+    long n_buscas_cruzadas;     // dessas, com o argumento na página
+                                //   seguinte, traduzido à parte
+  } perfil;
+#endif
+  // programas traduzidos associados a tabelas de páginas, e o programa
+  //   da tabela em uso (escolhido junto com a variante)
+  struct {
+    tabpag_t *tabpag;
+    trad_programa_t *trad;
+  } *traduzidos;
+  int n_traduzidos;
+  trad_programa_t *trad;
+#ifdef CPU_JIT
+  // tradutor para código nativo, e se vale a pena procurar um bloco
+  //   traduzido no PC atual (só depois de um desvio ou interrupção)
+  jit_t *jit;
+  bool tentar_jit;
+#endif
 };
 
+// ---------------------------------------------------------------------
+// perfil de execução
+// com CPU_PERFIL definido, mede quantas vezes e quanto tempo do
+//   hospedeiro cada instrução executa, e conta traduções de endereço,
+//   falhas de acesso e interrupções
+// sem CPU_PERFIL, as macros não geram código
+
+#ifdef CPU_PERFIL
+#if defined(__x86_64__) || defined(__i386__)
+#define PERFIL_UNIDADE "ciclos (rdtsc)"
+static inline uint64_t perfil_agora(void)
+{
+  return __rdtsc();
+}
+#else
+#define PERFIL_UNIDADE "ns"
+static inline uint64_t perfil_agora(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+#endif
+
+#define PERFIL_INICIO(self, l)                                            \
+  ((self)->perfil.linha = (l), (self)->perfil.inicio_linha = perfil_agora())
+#define PERFIL_FIM(self)                                                  \
+  ((self)->perfil.n[(self)->perfil.linha]++,                              \
+   (self)->perfil.tempo[(self)->perfil.linha] +=                          \
+     perfil_agora() - (self)->perfil.inicio_linha)
+#define PERFIL_CONTA(self, campo) ((self)->perfil.campo++)
+#else
+#define PERFIL_INICIO(self, l) ((void)0)
+#define PERFIL_FIM(self) ((void)0)
+#define PERFIL_CONTA(self, campo) ((void)0)
+#endif
+
+// função auxiliar, chamada pela memória quando uma posição é alterada
+static void cpu__invalida_instr(void *arg, int endereco, int n);
+
+// função auxiliar, escolhe a variante do interpretador para o modo atual
+static void cpu__escolhe_variante(cpu_t *self);
+
 cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
 {
   cpu_t *self;
   self = malloc(sizeof(*self));
   if (self != NULL) {
     self->mmu = mmu;
+    self->mem = mmu_mem(mmu);
     self->es = es;
     // inicializa registradores
     self->PC = 0;
@@ -39,6 +221,35 @@ cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
     self->complemento = 0;
     self->modo = supervisor;
     self->funcaoC = NULL;
+    // como a memória no início, o estado salvo é todo zero
+    self->salvo = (cpu_estado_t){ 0 };
+    self->estado_em_memoria = false;
+    self->interrupcao_direta = false;
+    self->tem_A1 = false;
+    self->traduzidos = NULL;
+    self->n_traduzidos = 0;
+    self->trad = NULL;
+    cpu__escolhe_variante(self);
+    for (int i = 0; i < TAM_CACHE_INSTR; i++) {
+      self->cache_instr[i].end = -1;
+    }
+    mem_define_obs_alteracao(mmu_mem(mmu), cpu__invalida_instr, self);
+    for (int f = 0; f < N_FUSAO; f++) {
+      self->n_fusoes[f] = 0;
+    }
+#ifdef CPU_PERFIL
+    memset(&self->perfil, 0, sizeof(self->perfil));
+    self->perfil.inicio = perfil_agora();
+#endif
+#ifdef CPU_JIT
+    self->jit = jit_cria(mmu);
+    if (self->jit == NULL) {
+      mem_define_obs_alteracao(mmu_mem(mmu), NULL, NULL);
+      free(self);
+      return NULL;
+    }
+    self->tentar_jit = true;
+#endif
     // gera uma interrupção de reset
     cpu_interrompe(self, IRQ_RESET);
   }
@@ -48,6 +259,11 @@ cpu_t *cpu_cria(mmu_t *mmu, es_t *es)
 void cpu_destroi(cpu_t *self)
 {
   // eu nao criei MMU nem es; quem criou que destrua!
+  mem_define_obs_alteracao(mmu_mem(self->mmu), NULL, NULL);
+#ifdef CPU_JIT
+  jit_destroi(self->jit);
+#endif
+  free(self->traduzidos);
   free(self);
 }
 
@@ -80,38 +296,80 @@ char *cpu_descricao(cpu_t *self)
 
 
 // ---------------------------------------------------------------------
-// funções auxiliares para usar durante a execução das instruções
-// alteram o estado da CPU caso ocorra erro
-
-// lê um valor da memória
-static bool pega_mem(cpu_t *self, int endereco, int *pval)
-{
-  self->erro = mmu_le(self->mmu, endereco, pval, self->modo);
-  if (self->erro == ERR_OK) return true;
-  self->complemento = endereco;
-  return false;
+// cache de instruções pré-decodificadas
+
+// verifica se a sequência de instruções a partir do endereço físico
+//   'endfis' corresponde à fusão 'f', e se está inteira no mesmo quadro
+// se estiver, preenche os argumentos da fusão em 'instr'
+static bool cpu__casa_fusao(cpu_t *self, instr_decod_t *instr, int endfis,
+                            fusao_t f)
+{
+  mem_t *mem = mmu_mem(self->mmu);
+  int end = endfis;
+  int ultimo_do_quadro = endfis | (TAM_PAGINA - 1);
+  for (int i = 0; i < fusoes[f].n_instr; i++) {
+    int opcode;
+    if (end > ultimo_do_quadro || mem_le(mem, end, &opcode) != ERR_OK) {
+      return false;
+    }
+    if (opcode != fusoes[f].opcode[i]) return false;
+    if (instrucao_num_args(opcode) > 0) {
+      end++;
+      if (end > ultimo_do_quadro) return false;
+      if (mem_le(mem, end, &instr->arg_fusao[i]) != ERR_OK) return false;
+    }
+    end++;
+  }
+  instr->tam = end - endfis;
+  return true;
 }
 
-// lê o opcode da instrução no PC
-static bool pega_opcode(cpu_t *self, int *popc)
-{
-  return pega_mem(self, self->PC, popc);
+// decodifica a instrução no endereço físico 'endfis' para a entrada 'instr'
+// o endereço já foi validado pela MMU
+static void cpu__decodifica(cpu_t *self, instr_decod_t *instr, int endfis)
+{
+  mem_t *mem = mmu_mem(self->mmu);
+  instr->end = endfis;
+  mem_le(mem, endfis, &instr->opcode);
+  // o argumento só pode ser lido junto se estiver no mesmo quadro
+  instr->tem_A1 = instrucao_num_args(instr->opcode) > 0
+                  && DESLOC_DO_END(endfis + 1) != 0
+                  && mem_le(mem, endfis + 1, &instr->A1) == ERR_OK;
+  instr->tam = instr->tem_A1 ? 2 : 1;
+  instr->fusao = SEM_FUSAO;
+  for (fusao_t f = SEM_FUSAO + 1; f < N_FUSAO; f++) {
+    if (fusoes[f].opcode[0] == instr->opcode
+        && cpu__casa_fusao(self, instr, endfis, f)) {
+      instr->fusao = f;
+      break;
+    }
+  }
 }
 
-// lê o argumento 1 da instrução no PC
-static bool pega_A1(cpu_t *self, int *pA1)
-{
-  return pega_mem(self, self->PC + 1, pA1);
+static void cpu__invalida_instr(void *arg, int endereco, int n)
+{
+  cpu_t *self = arg;
+  // a alteração pode ser em qualquer palavra coberta por uma entrada,
+  //   que pode iniciar até MAX_PALAVRAS_FUSAO - 1 palavras antes
+  // se o bloco alterado for maior que a cache, todas as entradas são
+  //   verificadas uma vez
+  int fim = endereco + n - 1;
+  int inicio = endereco - MAX_PALAVRAS_FUSAO + 1;
+  if (fim - inicio >= TAM_CACHE_INSTR) inicio = fim - TAM_CACHE_INSTR + 1;
+  for (int end = inicio; end <= fim; end++) {
+    instr_decod_t *instr = &self->cache_instr[end & (TAM_CACHE_INSTR - 1)];
+    if (instr->end != -1 && instr->end <= fim
+        && instr->end + instr->tam > endereco) {
+      instr->end = -1;
+    }
+  }
+#ifdef CPU_JIT
+  jit_invalida(self->jit, endereco, n);
+#endif
 }
 
-// escreve um valor na memória
-static bool poe_mem(cpu_t *self, int endereco, int val)
-{
-  self->erro = mmu_escreve(self->mmu, endereco, val, self->modo);
-  if (self->erro == ERR_OK) return true;
-  self->complemento = endereco;
-  return false;
-}
+// ---------------------------------------------------------------------
+// funções comuns a todas as variantes do interpretador
 
 // lê um valor da E/S
 static bool pega_es(cpu_t *self, int dispositivo, int *pval)
@@ -131,336 +389,491 @@ static bool poe_es(cpu_t *self, int dispositivo, int val)
   return false;
 }
 
-// ---------------------------------------------------------------------
-// funções auxiliares para implementação de cada instrução
-
-static void op_NOP(cpu_t *self) // não faz nada
-{
-  self->PC += 1;
-}
-
-static void op_PARA(cpu_t *self) // para a CPU
-{
-  if (self->modo == usuario) {
-    self->erro = ERR_INSTR_PRIV;
-    return;
-  }
-  self->erro = ERR_CPU_PARADA;
-}
+// declara uma função auxiliar (só para a interrupção e o retorno ficarem perto)
+static void cpu_desinterrompe(cpu_t *self);
 
-static void op_CARGI(cpu_t *self) // carrega imediato
+// retorna true se o erro é tratado pelo SO, que tem que vê-lo no estado
+//   salvo: uma violação de proteção, ou uma falta de página, que o SO
+//   resolve colocando a página na memória; como uma instrução que dá erro
+//   não altera o estado da CPU, ela é reexecutada no retorno da interrupção
+static bool cpu__erro_do_so(err_t erro)
 {
-  int A1;
-  if (pega_A1(self, &A1)) {
-    self->A = A1;
-    self->PC += 2;
-  }
+  return erro == ERR_PROT || erro == ERR_PAG_AUSENTE;
 }
 
-static void op_CARGM(cpu_t *self) // carrega da memória
+// retorna true se a instrução em self->instr inicia uma fusão que cabe
+//   nas 'n' instruções que ainda podem ser executadas
+static bool cpu__pode_fundir(cpu_t *self, int n)
 {
-  int A1, mA1;
-  if (pega_A1(self, &A1) && pega_mem(self, A1, &mA1)) {
-    self->A = mA1;
-    self->PC += 2;
-  }
+  fusao_t f = self->instr->fusao;
+  return f != SEM_FUSAO && fusoes[f].n_instr <= n;
 }
 
-static void op_CARGX(cpu_t *self) // carrega indexado
-{
-  int A1, mA1mX;
-  int X = self->X;
-  if (pega_A1(self, &A1) && pega_mem(self, A1 + X, &mA1mX)) {
-    self->A = mA1mX;
-    self->PC += 2;
-  }
-}
+// ---------------------------------------------------------------------
+// variantes do interpretador, uma para cada modo de execução (ver
+//   cpu_variante.inc)
+
+#define SUFIXO sup
+#define VARIANTE VAR_SUPERVISOR
+#define PRIVILEGIADO 1
+#define PAGINADO 0
+#include "cpu_variante.inc"
+#undef SUFIXO
+#undef VARIANTE
+#undef PRIVILEGIADO
+#undef PAGINADO
+
+#define SUFIXO usr_fis
+#define VARIANTE VAR_USUARIO_FISICO
+#define PRIVILEGIADO 0
+#define PAGINADO 0
+#include "cpu_variante.inc"
+#undef SUFIXO
+#undef VARIANTE
+#undef PRIVILEGIADO
+#undef PAGINADO
+
+#define SUFIXO usr_pag
+#define VARIANTE VAR_USUARIO_PAGINADO
+#define PRIVILEGIADO 0
+#define PAGINADO 1
+#include "cpu_variante.inc"
+#undef SUFIXO
+#undef VARIANTE
+#undef PRIVILEGIADO
+#undef PAGINADO
+
+// funções de cada variante
+static const struct {
+  // executa instruções a partir do PC, no máximo 'n'; retorna quantas
+  int (*executa)(cpu_t *self, int n);
+#ifdef CPU_JIT_VERIFICA
+  // interpreta a instrução no PC, sem fusão e sem tratar erro
+  void (*interpreta)(cpu_t *self);
+#endif
+} variantes[N_VARIANTE] = {
+#if defined(CPU_DESPACHO_DIRETO)
+  [VAR_SUPERVISOR]       = { cpu__executa_direto_sup },
+  [VAR_USUARIO_FISICO]   = { cpu__executa_direto_usr_fis },
+  [VAR_USUARIO_PAGINADO] = { cpu__executa_direto_usr_pag },
+#elif defined(CPU_JIT_VERIFICA)
+  [VAR_SUPERVISOR]       = { cpu__executa_switch_sup,
+                             cpu__interpreta_sup },
+  [VAR_USUARIO_FISICO]   = { cpu__executa_switch_usr_fis,
+                             cpu__interpreta_usr_fis },
+  [VAR_USUARIO_PAGINADO] = { cpu__executa_switch_usr_pag,
+                             cpu__interpreta_usr_pag },
+#else
+  [VAR_SUPERVISOR]       = { cpu__executa_switch_sup },
+  [VAR_USUARIO_FISICO]   = { cpu__executa_switch_usr_fis },
+  [VAR_USUARIO_PAGINADO] = { cpu__executa_switch_usr_pag },
+#endif
+};
 
-static void op_ARMM(cpu_t *self) // armazena na memória
-{
-  int A1;
-  if (pega_A1(self, &A1) && poe_mem(self, A1, self->A)) {
-    self->PC += 2;
+#ifdef CPU_JIT
+#ifdef CPU_JIT_VERIFICA
+// confere a execução de um bloco pelo JIT: desfaz as alterações que ele
+//   fez na memória, volta os registradores para 'antes', interpreta as
+//   mesmas instruções e compara registradores e memória com os do JIT
+// aborta a execução se houver diferença
+// 'mem_antes' tem o conteúdo da memória antes da execução do bloco
+static void cpu__verifica_jit(cpu_t *self, jit_regs_t *antes, jit_regs_t *jit,
+                              int *mem_antes, int feitas)
+{
+  mem_t *mem = mmu_mem(self->mmu);
+  int tam = mem_tam(mem);
+  int *mem_jit = malloc(tam * sizeof(int));
+  mem_le_bloco(mem, 0, mem_jit, tam);
+  for (int end = 0; end < tam; end++) {
+    if (mem_jit[end] != mem_antes[end]) mem_escreve(mem, end, mem_antes[end]);
   }
-}
-
-static void op_ARMX(cpu_t *self) // armazena indexado
-{
-  int A1;
-  int X = self->X;
-  if (pega_A1(self, &A1) && poe_mem(self, A1 + X, self->A)) {
-    self->PC += 2;
+  self->PC = antes->PC;
+  self->A = antes->A;
+  self->X = antes->X;
+  self->erro = antes->erro;
+  self->complemento = antes->complemento;
+  for (int i = 0; i < feitas; i++) {
+    variantes[self->variante].interpreta(self);
+    if (self->erro != ERR_OK) break;
   }
-}
-
-static void op_TRAX(cpu_t *self) // troca A com X
-{
-  int A = self->A;
-  int X = self->X;
-  self->X = A;
-  self->A = X;
-  self->PC += 1;
-}
-
-static void op_CPXA(cpu_t *self) // copia X para A
-{
-  self->A = self->X;
-  self->PC += 1;
-}
-
-static void op_INCX(cpu_t *self) // incrementa X
-{
-  self->X += 1;
-  self->PC += 1;
-}
-
-static void op_SOMA(cpu_t *self) // soma
-{
-  int A1, mA1;
-  if (pega_A1(self, &A1) && pega_mem(self, A1, &mA1)) {
-    self->A += mA1;
-    self->PC += 2;
+  bool igual = self->PC == jit->PC && self->A == jit->A && self->X == jit->X
+               && self->erro == jit->erro
+               && (self->erro == ERR_OK || self->complemento == jit->complemento);
+  int *mem_interp = malloc(tam * sizeof(int));
+  mem_le_bloco(mem, 0, mem_interp, tam);
+  int end_dif = -1;
+  for (int end = 0; end < tam && end_dif == -1; end++) {
+    if (mem_interp[end] != mem_jit[end]) end_dif = end;
   }
-}
-
-static void op_SUB(cpu_t *self) // subtração
-{
-  int A1, mA1;
-  if (pega_A1(self, &A1) && pega_mem(self, A1, &mA1)) {
-    self->A -= mA1;
-    self->PC += 2;
+  if (!igual || end_dif != -1) {
+    fprintf(stderr, "JIT: bloco em PC=%d (%d instruções) diverge do interpretador\n"
+                    "  JIT:           PC=%d A=%d X=%d erro=%d compl=%d\n"
+                    "  interpretador: PC=%d A=%d X=%d erro=%d compl=%d\n",
+            antes->PC, feitas,
+            jit->PC, jit->A, jit->X, jit->erro, jit->complemento,
+            self->PC, self->A, self->X, self->erro, self->complemento);
+    if (end_dif != -1) {
+      fprintf(stderr, "  memória[%d]: JIT %d, interpretador %d\n",
+              end_dif, mem_jit[end_dif], mem_interp[end_dif]);
+    }
+    abort();
   }
-}
-
-static void op_MULT(cpu_t *self) // multiplicação
-{
-  int A1, mA1;
-  if (pega_A1(self, &A1) && pega_mem(self, A1, &mA1)) {
-    self->A *= mA1;
-    self->PC += 2;
+  free(mem_interp);
+  free(mem_jit);
+}
+#endif // CPU_JIT_VERIFICA
+
+// executa um bloco traduzido pelo JIT a partir do PC, se houver, com no
+//   máximo 'n' instruções
+// retorna o número de instruções executadas, 0 se não executou
+static int cpu__executa_jit(cpu_t *self, int n)
+{
+  jit_regs_t regs = {
+    self->PC, self->A, self->X, self->erro, self->complemento
+  };
+#ifdef CPU_JIT_VERIFICA
+  jit_regs_t antes = regs;
+  mem_t *mem = mmu_mem(self->mmu);
+  int *mem_antes = malloc(mem_tam(mem) * sizeof(int));
+  mem_le_bloco(mem, 0, mem_antes, mem_tam(mem));
+#endif
+  PERFIL_INICIO(self, PERFIL_JIT);
+  int feitas = jit_executa(self->jit, &regs, self->modo, n);
+  PERFIL_FIM(self);
+#ifdef CPU_JIT_VERIFICA
+  if (feitas > 0) cpu__verifica_jit(self, &antes, &regs, mem_antes, feitas);
+  free(mem_antes);
+#endif
+  if (feitas == 0) return 0;
+  self->PC = regs.PC;
+  self->A = regs.A;
+  self->X = regs.X;
+  self->erro = regs.erro;
+  self->complemento = regs.complemento;
+  // o JIT só executa em modo usuário
+  if (self->erro != ERR_OK) {
+    cpu_interrompe(self, IRQ_ERR_CPU);
   }
-}
-
-static void op_DIV(cpu_t *self) // divisão
-{
-  int A1, mA1;
-  if (pega_A1(self, &A1) && pega_mem(self, A1, &mA1)) {
-    self->A /= mA1;
-    self->PC += 2;
+  return feitas;
+}
+#endif // CPU_JIT
+
+// retorna o programa traduzido que está em execução, NULL se não houver
+static trad_programa_t *cpu__traduzido(cpu_t *self)
+{
+  if (self->trad != NULL && self->trad->alterado) return NULL;
+  return self->trad;
+}
+
+// executa código traduzido a partir do PC, no máximo 'n' instruções
+// retorna o número de instruções executadas, 0 se não executou
+static int cpu__executa_traduzido(cpu_t *self, trad_programa_t *trad, int n)
+{
+  trad_estado_t estado = {
+    self->PC, self->A, self->X, self->erro, self->complemento,
+    self->mmu, trad
+  };
+  PERFIL_INICIO(self, PERFIL_TRADUZIDO);
+  int feitas = trad->executa(&estado, n);
+  PERFIL_FIM(self);
+  if (feitas == 0) return 0;
+  trad->n_instr += feitas;
+  self->PC = estado.PC;
+  self->A = estado.A;
+  self->X = estado.X;
+  self->erro = estado.erro;
+  self->complemento = estado.complemento;
+  // o código traduzido só executa em modo usuário
+  if (self->erro != ERR_OK) {
+    cpu_interrompe(self, IRQ_ERR_CPU);
   }
+  return feitas;
 }
 
-static void op_RESTO(cpu_t *self) // resto
+void cpu_executa_1(cpu_t *self)
 {
-  int A1, mA1;
-  if (pega_A1(self, &A1) && pega_mem(self, A1, &mA1)) {
-    self->A %= mA1;
-    self->PC += 2;
+  cpu_executa_n(self, 1);
+}
+
+int cpu_executa_n(cpu_t *self, int n)
+{
+#ifdef CPU_PERFIL
+  uint64_t inicio = perfil_agora();
+#endif
+  int feitas = 0;
+  while (feitas < n && self->erro == ERR_OK) {
+    trad_programa_t *trad = cpu__traduzido(self);
+    if (trad != NULL) {
+      int no_trad = cpu__executa_traduzido(self, trad, n - feitas);
+      if (no_trad > 0) {
+        feitas += no_trad;
+        continue;
+      }
+    }
+#if defined(CPU_DESPACHO_DIRETO)
+    // com código traduzido, interpreta uma instrução de cada vez, para
+    //   voltar a ele assim que possível
+    feitas += variantes[self->variante].executa(self,
+                                                trad != NULL ? 1 : n - feitas);
+#elif defined(CPU_JIT)
+    if (trad == NULL && self->tentar_jit) {
+      int no_jit = cpu__executa_jit(self, n - feitas);
+      if (no_jit > 0) {
+        feitas += no_jit;
+        continue;
+      }
+      self->tentar_jit = false;
+    }
+    int PC = self->PC;
+    feitas += variantes[self->variante].executa(self, n - feitas);
+    if (self->PC != PC + 1 && self->PC != PC + 2) self->tentar_jit = true;
+#else
+    feitas += variantes[self->variante].executa(self, n - feitas);
+#endif
   }
-}
-
-static void op_NEG(cpu_t *self) // inverte sinal
-{
-  self->A = -self->A;
-  self->PC += 1;
-}
-
-static void op_DESV(cpu_t *self) // desvio incondicional
-{
-  int A1;
-  if (pega_A1(self, &A1)) {
-    self->PC = A1;
+#ifdef CPU_PERFIL
+  self->perfil.tempo_cpu += perfil_agora() - inicio;
+#endif
+  return feitas;
+}
+
+#ifdef CPU_PERFIL
+// nome de uma linha do perfil
+static char *cpu__nome_perfil(int linha)
+{
+  switch (linha) {
+    case PERFIL_FUSAO:     return "(fusões)";
+    case PERFIL_INVALIDA:  return "(inválida)";
+    case PERFIL_TRADUZIDO: return "(traduzido)";
+    case PERFIL_JIT:       return "(JIT)";
+    default:               return instrucao_nome(linha);
   }
 }
 
-static void op_DESVZ(cpu_t *self) // desvio condicional
+// imprime 'nome' alinhado à esquerda em 'largura' colunas
+// (printf conta bytes, e os caracteres acentuados ocupam dois em UTF-8)
+static void cpu__imprime_nome(FILE *arq, char *nome, int largura)
 {
-  if (self->A == 0) {
-    op_DESV(self);
-  } else {
-    self->PC += 2;
+  for (char *c = nome; *c != '\0'; c++) {
+    if ((*c & 0xC0) == 0x80) largura++;
   }
+  fprintf(arq, "  %-*s", largura, nome);
 }
 
-static void op_DESVNZ(cpu_t *self) // desvio condicional
+// tempo em cpu_executa_n fora das linhas do perfil (busca, decodificação
+//   e despacho das instruções), e tempo fora de cpu_executa_n (controle,
+//   console, relógio)
+static void cpu__tempos_perfil(cpu_t *self, uint64_t *pdespacho,
+                               uint64_t *pfora, uint64_t *ptotal)
 {
-  if (self->A != 0) {
-    op_DESV(self);
-  } else {
-    self->PC += 2;
+  uint64_t nas_linhas = 0;
+  for (int l = 0; l < N_PERFIL; l++) {
+    nas_linhas += self->perfil.tempo[l];
   }
-}
-
-static void op_DESVN(cpu_t *self) // desvio condicional
-{
-  if (self->A < 0) {
-    op_DESV(self);
-  } else {
-    self->PC += 2;
+  *ptotal = perfil_agora() - self->perfil.inicio;
+  *pdespacho = self->perfil.tempo_cpu - nas_linhas;
+  *pfora = *ptotal - self->perfil.tempo_cpu;
+}
+
+// imprime a tabela do perfil, em ordem decrescente de tempo
+// o tempo de CHAMAC inclui o tratamento das interrupções pelo SO
+static void cpu__relatorio_perfil(cpu_t *self, FILE *arq)
+{
+  uint64_t despacho, fora, total;
+  cpu__tempos_perfil(self, &despacho, &fora, &total);
+  int ordem[N_PERFIL];
+  for (int l = 0; l < N_PERFIL; l++) {
+    // ordenação por inserção
+    int i = l;
+    while (i > 0 && self->perfil.tempo[ordem[i - 1]] < self->perfil.tempo[l]) {
+      ordem[i] = ordem[i - 1];
+      i--;
+    }
+    ordem[i] = l;
   }
-}
-
-static void op_DESVP(cpu_t *self) // desvio condicional
-{
-  if (self->A > 0) {
-    op_DESV(self);
-  } else {
-    self->PC += 2;
+  double pct = total == 0 ? 0.0 : 100.0 / total;
+  fprintf(arq, "CPU: perfil de execução, tempo em " PERFIL_UNIDADE "\n");
+  fprintf(arq, "  %-20s %10s %14s %10s %6s\n",
+          "", "vezes", "tempo", "tempo/vez", "%");
+  for (int i = 0; i < N_PERFIL; i++) {
+    int l = ordem[i];
+    if (self->perfil.n[l] == 0) continue;
+    cpu__imprime_nome(arq, cpu__nome_perfil(l), 20);
+    fprintf(arq, " %10ld %14llu %10.1f %6.2f\n", self->perfil.n[l],
+            (unsigned long long)self->perfil.tempo[l],
+            (double)self->perfil.tempo[l] / self->perfil.n[l],
+            self->perfil.tempo[l] * pct);
   }
-}
-
-static void op_CHAMA(cpu_t *self) // chamada de subrotina
-{
-  int A1;
-  if (pega_A1(self, &A1) && poe_mem(self, A1, self->PC + 2)) {
-    self->PC = A1 + 1;
+  fprintf(arq, "  %-20s %10s %14llu %10s %6.2f\n", "(busca e despacho)", "",
+          (unsigned long long)despacho, "", despacho * pct);
+  fprintf(arq, "  %-20s %10s %14llu %10s %6.2f\n", "(fora da CPU)", "",
+          (unsigned long long)fora, "", fora * pct);
+  fprintf(arq, "CPU: %ld traduções de endereço pela MMU, %ld falhas de acesso "
+               "à memória\n", self->perfil.n_traducoes, self->perfil.n_falhas);
+  fprintf(arq, "CPU: %ld buscas de instrução, %ld com o argumento na página "
+               "seguinte (%.2f%%)\n", self->perfil.n_buscas,
+          self->perfil.n_buscas_cruzadas,
+          self->perfil.n_buscas == 0
+            ? 0.0
+            : 100.0 * self->perfil.n_buscas_cruzadas / self->perfil.n_buscas);
+  fprintf(arq, "CPU: interrupções aceitas\n");
+  for (irq_t irq = 0; irq < N_IRQ; irq++) {
+    cpu__imprime_nome(arq, irq_nome(irq), 20);
+    fprintf(arq, " %10ld\n", self->perfil.n_interrupcoes[irq]);
   }
 }
 
-static void op_RET(cpu_t *self) // retorno de subrotina
+void cpu_perfil_csv(cpu_t *self, FILE *arq)
 {
-  int A1, mA1;
-  if (pega_A1(self, &A1) && pega_mem(self, A1, &mA1)) {
-    self->PC = mA1;
+  uint64_t despacho, fora, total;
+  cpu__tempos_perfil(self, &despacho, &fora, &total);
+  fprintf(arq, "linha,execucoes,tempo\n");
+  for (int l = 0; l < N_PERFIL; l++) {
+    fprintf(arq, "%s,%ld,%llu\n", cpu__nome_perfil(l), self->perfil.n[l],
+            (unsigned long long)self->perfil.tempo[l]);
   }
+  fprintf(arq, "(busca e despacho),,%llu\n", (unsigned long long)despacho);
+  fprintf(arq, "(fora da CPU),,%llu\n", (unsigned long long)fora);
+  fprintf(arq, "(total),,%llu\n", (unsigned long long)total);
 }
+#endif // CPU_PERFIL
 
-static void op_LE(cpu_t *self) // leitura de E/S
+void cpu_relatorio(cpu_t *self, FILE *arq)
 {
-  if (self->modo == usuario) {
-    self->erro = ERR_INSTR_PRIV;
-    return;
+  fprintf(arq, "CPU: instruções fundidas\n");
+  for (fusao_t f = SEM_FUSAO + 1; f < N_FUSAO; f++) {
+    fprintf(arq, "  %-24s %10ld vezes %10ld instruções\n", fusoes[f].nome,
+            self->n_fusoes[f], self->n_fusoes[f] * fusoes[f].n_instr);
   }
-  int A1, dado;
-  if (pega_A1(self, &A1) && pega_es(self, A1, &dado)) {
-    self->A = dado;
-    self->PC += 2;
+#ifdef CPU_JIT
+  jit_relatorio(self->jit, arq);
+#endif
+#ifdef CPU_PERFIL
+  cpu__relatorio_perfil(self, arq);
+#endif
+  for (int i = 0; trad_programas[i] != NULL; i++) {
+    trad_programa_t *trad = trad_programas[i];
+    fprintf(arq, "CPU: %s traduzido, %ld instruções executadas%s\n",
+            trad->nome, trad->n_instr,
+            trad->alterado ? " (código alterado, deixou de ser usado)" : "");
   }
 }
 
-static void op_ESCR(cpu_t *self) // escrita de E/S
+void cpu_associa_traduzido(cpu_t *self, tabpag_t *tabpag, trad_programa_t *trad)
 {
-  if (self->modo == usuario) {
-    self->erro = ERR_INSTR_PRIV;
-    return;
-  }
-  int A1;
-  if (pega_A1(self, &A1) && poe_es(self, A1, self->A)) {
-    self->PC += 2;
+  int i;
+  for (i = 0; i < self->n_traduzidos; i++) {
+    if (self->traduzidos[i].tabpag == tabpag) break;
   }
-}
-
-// declara uma função auxiliar (só para a interrupção e o retorno ficarem perto)
-static void cpu_desinterrompe(cpu_t *self);
-
-static void op_RETI(cpu_t *self) // retorno de interrupção
-{
-  if (self->modo == usuario) {
-    self->erro = ERR_INSTR_PRIV;
-    return;
+  if (i == self->n_traduzidos) {
+    if (trad == NULL) return;
+    void *novo = realloc(self->traduzidos,
+                         (i + 1) * sizeof(self->traduzidos[0]));
+    if (novo == NULL) return;
+    self->traduzidos = novo;
+    self->n_traduzidos++;
+    self->traduzidos[i].tabpag = tabpag;
   }
-  cpu_desinterrompe(self);
+  self->traduzidos[i].trad = trad;
+  // o SO executa em modo supervisor; a associação vale a partir do
+  //   próximo retorno de interrupção
 }
 
-static void op_CHAMAC(cpu_t *self) // chama função em C
+static void cpu__escolhe_variante(cpu_t *self)
 {
-  if (self->modo == usuario) {
-    self->erro = ERR_INSTR_PRIV;
+  tabpag_t *tabpag = mmu_tabpag(self->mmu);
+  self->trad = NULL;
+  if (self->modo == supervisor) {
+    self->variante = VAR_SUPERVISOR;
     return;
   }
-  if (self->funcaoC == NULL) {
-    self->erro = ERR_OP_INV;
-    return;
+  self->variante = tabpag == NULL ? VAR_USUARIO_FISICO : VAR_USUARIO_PAGINADO;
+  for (int i = 0; i < self->n_traduzidos; i++) {
+    if (self->traduzidos[i].tabpag == tabpag) {
+      self->trad = self->traduzidos[i].trad;
+    }
   }
-  self->erro = self->funcaoC(self->argC, self->A);
-  self->PC += 1;
 }
 
-static void op_CHAMAS(cpu_t *self) // chamada de sistema
+// o erro que a CPU salva ao ser interrompida
+// na memória, o erro salvo era o da escrita do PC, que sempre dá certo, e
+//   o SO não via o erro que causou a interrupção; isso é mantido para os
+//   erros que já existiam, mas os que o SO trata são sempre salvos
+static err_t cpu__erro_salvo(err_t erro)
 {
-  self->PC += 1;
-  // causa uma interrupção, para forçar a execução do SO
-  cpu_interrompe(self, IRQ_SISTEMA);
-
-}
-
-void cpu_executa_1(cpu_t *self)
-{
-  // não executa se CPU já estiver em erro
-  if (self->erro != ERR_OK) return;
-
-  int opcode;
-  if (!pega_opcode(self, &opcode)) return;
-
-  switch (opcode) {
-    case NOP:    op_NOP(self);    break;
-    case PARA:   op_PARA(self);   break;
-    case CARGI:  op_CARGI(self);  break;
-    case CARGM:  op_CARGM(self);  break;
-    case CARGX:  op_CARGX(self);  break;
-    case ARMM:   op_ARMM(self);   break;
-    case ARMX:   op_ARMX(self);   break;
-    case TRAX:   op_TRAX(self);   break;
-    case CPXA:   op_CPXA(self);   break;
-    case INCX:   op_INCX(self);   break;
-    case SOMA:   op_SOMA(self);   break;
-    case SUB:    op_SUB(self);    break;
-    case MULT:   op_MULT(self);   break;
-    case DIV:    op_DIV(self);    break;
-    case RESTO:  op_RESTO(self);  break;
-    case NEG:    op_NEG(self);    break;
-    case DESV:   op_DESV(self);   break;
-    case DESVZ:  op_DESVZ(self);  break;
-    case DESVNZ: op_DESVNZ(self); break;
-    case DESVN:  op_DESVN(self);  break;
-    case DESVP:  op_DESVP(self);  break;
-    case CHAMA:  op_CHAMA(self);  break;
-    case RET:    op_RET(self);    break;
-    case LE:     op_LE(self);     break;
-    case ESCR:   op_ESCR(self);   break;
-    case RETI:   op_RETI(self);   break;
-    case CHAMAC: op_CHAMAC(self); break;
-    case CHAMAS: op_CHAMAS(self); break;
-    default:     self->erro = ERR_INSTR_INV;
-  }
-
-  if (self->erro != ERR_OK && self->erro != ERR_CPU_PARADA && self->modo == usuario) {
-    cpu_interrompe(self, IRQ_ERR_CPU);
-  }
+  return cpu__erro_do_so(erro) ? erro : ERR_OK;
 }
 
 bool cpu_interrompe(cpu_t *self, irq_t irq)
 {
   // só aceita interrupção em modo usuário
   if (self->modo != usuario) return false;
+  PERFIL_CONTA(self, n_interrupcoes[irq]);
   // esta é uma CPU boazinha, salva todo o estado interno da CPU
   // poe em modo supervisor, para que o acesso seja feito na memória física
   self->modo = supervisor;
-  poe_mem(self, IRQ_END_PC,          self->PC);
-  poe_mem(self, IRQ_END_A,           self->A);
-  poe_mem(self, IRQ_END_X,           self->X);
-  poe_mem(self, IRQ_END_erro,        self->erro);
-  poe_mem(self, IRQ_END_complemento, self->complemento);
-  poe_mem(self, IRQ_END_modo,        usuario);
+  cpu__escolhe_variante(self);
+  if (self->estado_em_memoria) {
+    err_t erro = self->erro;
+    poe_mem_sup(self, IRQ_END_PC,          self->PC);
+    poe_mem_sup(self, IRQ_END_A,           self->A);
+    poe_mem_sup(self, IRQ_END_X,           self->X);
+    poe_mem_sup(self, IRQ_END_erro,        cpu__erro_salvo(erro));
+    poe_mem_sup(self, IRQ_END_complemento, self->complemento);
+    poe_mem_sup(self, IRQ_END_modo,        usuario);
+  } else {
+    self->salvo.PC = self->PC;
+    self->salvo.A = self->A;
+    self->salvo.X = self->X;
+    self->salvo.erro = cpu__erro_salvo(self->erro);
+    self->salvo.complemento = self->complemento;
+    self->salvo.modo = usuario;
+  }
 
   self->A = irq;
   self->erro = ERR_OK;
   self->PC = 10;
 
+  if (self->interrupcao_direta && self->funcaoC != NULL) {
+    // faz o que fariam as instruções CHAMAC e RETI no endereço 10, sem
+    //   executá-las
+    self->erro = self->funcaoC(self->argC, self->A);
+    self->PC += 1;
+    if (self->erro == ERR_OK) cpu_desinterrompe(self);
+  }
+
   return true;
 }
 
+// o erro recuperado é ERR_OK, exceto ERR_CPU_PARADA: o SO retorna assim
+//   quando nenhum processo pode executar, e a CPU fica parada, sem executar
+//   instruções, até a próxima interrupção
 static void cpu_desinterrompe(cpu_t *self)
 {
-  int dado;
-  pega_mem(self, IRQ_END_PC,          &self->PC);
-  pega_mem(self, IRQ_END_A,           &self->A);
-  pega_mem(self, IRQ_END_X,           &self->X);
-  pega_mem(self, IRQ_END_erro,        &dado);
-  self->erro = dado;
-  pega_mem(self, IRQ_END_complemento, &self->complemento);
-  pega_mem(self, IRQ_END_modo,        &dado);
-  self->modo = dado;
+  err_t erro;
+  if (!self->estado_em_memoria) {
+    self->PC = self->salvo.PC;
+    self->A = self->salvo.A;
+    self->X = self->salvo.X;
+    // na memória, o erro recuperado é o da leitura de complemento, que
+    //   sempre dá certo
+    erro = self->salvo.erro;
+    self->erro = ERR_OK;
+    self->complemento = self->salvo.complemento;
+    self->modo = self->salvo.modo;
+  } else {
+    int dado;
+    pega_mem_sup(self, IRQ_END_PC,          &self->PC);
+    pega_mem_sup(self, IRQ_END_A,           &self->A);
+    pega_mem_sup(self, IRQ_END_X,           &self->X);
+    pega_mem_sup(self, IRQ_END_erro,        &dado);
+    erro = dado;
+    pega_mem_sup(self, IRQ_END_complemento, &self->complemento);
+    pega_mem_sup(self, IRQ_END_modo,        &dado);
+    self->modo = dado;
+  }
+  if (erro == ERR_CPU_PARADA) self->erro = ERR_CPU_PARADA;
+  cpu__escolhe_variante(self);
 }
 
 void cpu_define_chamaC(cpu_t *self, func_chamaC_t funcaoC, void *argC)
@@ -469,3 +882,48 @@ void cpu_define_chamaC(cpu_t *self, func_chamaC_t funcaoC, void *argC)
   self->argC = argC;
 }
 
+void cpu_pega_estado(cpu_t *self, cpu_estado_t *estado)
+{
+  if (!self->estado_em_memoria) {
+    *estado = self->salvo;
+    return;
+  }
+  int dado;
+  mem_le(self->mem, IRQ_END_PC,          &estado->PC);
+  mem_le(self->mem, IRQ_END_A,           &estado->A);
+  mem_le(self->mem, IRQ_END_X,           &estado->X);
+  mem_le(self->mem, IRQ_END_erro,        &dado);
+  estado->erro = dado;
+  mem_le(self->mem, IRQ_END_complemento, &estado->complemento);
+  mem_le(self->mem, IRQ_END_modo,        &dado);
+  estado->modo = dado;
+}
+
+void cpu_define_estado(cpu_t *self, cpu_estado_t *estado)
+{
+  if (!self->estado_em_memoria) {
+    self->salvo = *estado;
+    return;
+  }
+  mem_escreve(self->mem, IRQ_END_PC,          estado->PC);
+  mem_escreve(self->mem, IRQ_END_A,           estado->A);
+  mem_escreve(self->mem, IRQ_END_X,           estado->X);
+  mem_escreve(self->mem, IRQ_END_erro,        estado->erro);
+  mem_escreve(self->mem, IRQ_END_complemento, estado->complemento);
+  mem_escreve(self->mem, IRQ_END_modo,        estado->modo);
+}
+
+void cpu_define_estado_em_memoria(cpu_t *self, bool em_memoria)
+{
+  if (em_memoria == self->estado_em_memoria) return;
+  // leva o estado salvo para o novo lugar
+  cpu_estado_t estado;
+  cpu_pega_estado(self, &estado);
+  self->estado_em_memoria = em_memoria;
+  cpu_define_estado(self, &estado);
+}
+
+void cpu_define_interrupcao_direta(cpu_t *self, bool direta)
+{
+  self->interrupcao_direta = direta;
+}
@@ -13,12 +13,24 @@
 #include "mmu.h"
 #include "es.h"
 #include "irq.h"
+#include "traduzido.h"
+#include <stdio.h>
 
 typedef struct cpu_t cpu_t; // tipo opaco
 
 // tipo da função a ser chamada quando executar a instrução CHAMAC
 typedef err_t (*func_chamaC_t)(void *argC, int reg_A);
 
+// estado da CPU salvo na interrupção, para ser recuperado no retorno
+typedef struct {
+  int PC;
+  int A;
+  int X;
+  err_t erro;
+  int complemento;
+  cpu_modo_t modo;
+} cpu_estado_t;
+
 
 // cria uma unidade de execução com acesso à MMU e ao
 //   controlador de E/S fornecidos
@@ -30,13 +42,46 @@ void cpu_destroi(cpu_t *self);
 // executa uma instrução
 void cpu_executa_1(cpu_t *self);
 
+// executa até 'n' instruções, com o mesmo efeito de chamar cpu_executa_1
+//   'n' vezes, mas sem sair da CPU entre uma instrução e outra
+// retorna antes se a CPU ficar em erro (inclusive parada) -- erros em modo
+//   usuário viram interrupção e não interrompem o lote
+// retorna o número de instruções executadas, incluindo a que causou o erro
+//   (0 se a CPU já estava em erro)
+int cpu_executa_n(cpu_t *self, int n);
+
 // implementa uma interrupção
-// passa para modo supervisor, salva o estado da CPU no início da memória,
-//   altera A para identificar a requisição de interrupção, altera PC para
-//   o endereço do tratador de interrupção
+// passa para modo supervisor, salva o estado da CPU (ver
+//   cpu_define_estado_em_memoria), altera A para identificar a requisição
+//   de interrupção, altera PC para o endereço do tratador de interrupção
+// com interrupção direta (ver cpu_define_interrupcao_direta), chama em
+//   seguida a função de CHAMAC e retorna da interrupção
 // retorna true se interrupção foi aceita ou false caso contrário
 bool cpu_interrompe(cpu_t *self, irq_t irq);
 
+// coloca em 'estado' o estado salvo na última interrupção, que vai ser
+//   recuperado no retorno dela (instrução RETI)
+void cpu_pega_estado(cpu_t *self, cpu_estado_t *estado);
+
+// altera o estado a recuperar no retorno da interrupção
+// do erro, só ERR_CPU_PARADA é recuperado: a CPU fica parada até a próxima
+//   interrupção
+void cpu_define_estado(cpu_t *self, cpu_estado_t *estado);
+
+// define onde o estado é salvo na interrupção:
+// - false (padrão) - em registradores internos da CPU
+// - true           - na memória, a partir do endereço 0 (ver IRQ_END_*
+//                    em irq.h), como nas versões anteriores
+// nos dois casos, o estado é acessado com cpu_pega_estado e
+//   cpu_define_estado
+void cpu_define_estado_em_memoria(cpu_t *self, bool em_memoria);
+
+// define se a interrupção chama diretamente a função definida com
+//   cpu_define_chamaC e retorna, sem executar o tratador no endereço 10
+//   (que normalmente contém CHAMAC e RETI)
+// com isso, essas duas instruções não são executadas nem contadas
+void cpu_define_interrupcao_direta(cpu_t *self, bool direta);
+
 // define a função a chamar quando executar a instrução CHAMAC
 // e o argumento a passar para ela (normalmente, um ponteiro para o SO)
 void cpu_define_chamaC(cpu_t *self, func_chamaC_t func, void *argC);
@@ -44,4 +89,25 @@ void cpu_define_chamaC(cpu_t *self, func_chamaC_t func, void *argC);
 // retorna uma string (estática), com o estado da CPU
 char *cpu_descricao(cpu_t *self);
 
+// imprime em 'arq' as estatísticas de execução da CPU
+// (quantas vezes cada sequência de instruções fundidas foi executada)
+// com CPU_PERFIL definido (make PERFIL=sim), imprime também o perfil de
+//   execução: quantas vezes e quanto tempo do hospedeiro cada instrução
+//   executou, o tempo de busca e despacho e fora da CPU, o número de
+//   traduções de endereço, falhas de acesso à memória e interrupções, e
+//   quantas instruções foram buscadas, e em quantas o argumento estava na
+//   página seguinte à do opcode
+void cpu_relatorio(cpu_t *self, FILE *arq);
+
+#ifdef CPU_PERFIL
+// escreve em 'arq' a tabela do perfil de execução, em formato CSV
+void cpu_perfil_csv(cpu_t *self, FILE *arq);
+#endif
+
+// associa o programa traduzido 'trad' à tabela de páginas 'tabpag'
+// quando estiver em modo usuário com essa tabela na MMU, a CPU executa
+//   o código traduzido no lugar de interpretar as instruções
+// 'trad' NULL desfaz a associação (deve ser feito antes de destruir a tabela)
+void cpu_associa_traduzido(cpu_t *self, tabpag_t *tabpag, trad_programa_t *trad);
+
 #endif // CPU_H
@@ -9,6 +9,8 @@ static char *nomes[N_ERR] = {
   [ERR_DISP_INV]   = "Dispositivo inválido",
   [ERR_OCUP]       = "Dispositivo ocupado",
   [ERR_INSTR_PRIV] = "Instrução privilegiada",
+  [ERR_PAG_AUSENTE] = "Página ausente",
+  [ERR_PROT]       = "Violação de proteção",
 };
 
 // retorna o nome de erro
@@ -0,0 +1,640 @@
+#include "jit.h"
+#include "instrucao.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#if !defined(__x86_64__)
+#error "o JIT só gera código para x86-64"
+#endif
+
+// número de entradas na tabela de blocos (potência de 2)
+#define TAM_TAB_BLOCOS 4096
+// número de vezes que a execução passa por um endereço antes de traduzir
+//   o bloco que inicia nele
+#define LIMIAR_JIT 20
+// tamanho máximo de um bloco, em instruções e em palavras de memória
+#define MAX_INSTR_BLOCO 16
+#define MAX_PALAVRAS_BLOCO 32
+// número de entradas na TLB usada pelo código gerado (potência de 2)
+#define TAM_TLB 64
+// tamanho da memória para código gerado, e o máximo que um bloco pode ocupar
+#define TAM_CODIGO (4 * 1024 * 1024)
+#define MAX_BYTES_BLOCO 8192
+
+// uma entrada da TLB: a página virtual e onde está, no hospedeiro, o
+//   quadro que a contém
+// só páginas de quadros que estão inteiros na memória entram na TLB, e
+//   a leitura pela TLB não marca a página como acessada; a página entra
+//   na TLB em uma leitura pela MMU, que a marca
+typedef struct {
+  int pagina;  // -1 se a entrada está vazia
+  int *base;
+} entrada_tlb_t;
+_Static_assert(sizeof(entrada_tlb_t) == 16, "o código gerado indexa a TLB com shl 4");
+
+// estado acessado pelo código gerado, através de rbx
+typedef struct {
+  int PC;
+  int A;
+  int X;
+  err_t erro;
+  int complemento;
+  int valor;      // valor lido por jit__le
+  int invalidou;  // se algum bloco foi descartado durante a execução
+  mmu_t *mmu;
+  entrada_tlb_t tlb[TAM_TLB];
+} estado_t;
+
+typedef int (*codigo_t)(estado_t *estado);
+
+// uma entrada da tabela de blocos, indexada pelo endereço físico do início
+//   do bloco
+typedef struct {
+  int end;         // endereço físico do início, -1 se a entrada está vazia
+  int pc;          // endereço virtual do início
+  int tam;         // número de palavras cobertas pelo bloco
+  int n_instr;     // número de instruções do bloco
+  int contador;    // execuções até agora; -1 se não dá para traduzir
+  codigo_t codigo; // NULL se ainda não traduzido
+} bloco_t;
+
+struct jit_t {
+  mmu_t *mmu;
+  estado_t estado;
+  // tabela e versão para as quais as traduções na TLB valem
+  tabpag_t *tlb_tabpag;
+  unsigned tlb_versao;
+  bloco_t blocos[TAM_TAB_BLOCOS];
+  // memória para o código gerado, usada em sequência e liberada toda de
+  //   uma vez quando enche
+  uint8_t *codigo;
+  int codigo_usado;
+  bool executando;
+  // estatísticas
+  long n_traduzidos;
+  long n_execucoes;
+  long n_instr;
+  long n_invalidados;
+  long n_esvaziamentos;
+};
+
+static void jit__esvazia_tlb(jit_t *self);
+
+jit_t *jit_cria(mmu_t *mmu)
+{
+  jit_t *self = malloc(sizeof(*self));
+  if (self == NULL) return NULL;
+  self->codigo = mmap(NULL, TAM_CODIGO, PROT_READ | PROT_WRITE | PROT_EXEC,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (self->codigo == MAP_FAILED) {
+    free(self);
+    return NULL;
+  }
+  self->codigo_usado = 0;
+  self->mmu = mmu;
+  self->estado.mmu = mmu;
+  jit__esvazia_tlb(self);
+  for (int i = 0; i < TAM_TAB_BLOCOS; i++) {
+    self->blocos[i].end = -1;
+  }
+  self->executando = false;
+  self->n_traduzidos = 0;
+  self->n_execucoes = 0;
+  self->n_instr = 0;
+  self->n_invalidados = 0;
+  self->n_esvaziamentos = 0;
+  return self;
+}
+
+void jit_destroi(jit_t *self)
+{
+  munmap(self->codigo, TAM_CODIGO);
+  free(self);
+}
+
+
+// ---------------------------------------------------------------------
+// TLB E FUNÇÕES CHAMADAS PELO CÓDIGO GERADO
+
+static void jit__esvazia_tlb(jit_t *self)
+{
+  for (int i = 0; i < TAM_TLB; i++) {
+    self->estado.tlb[i].pagina = -1;
+  }
+  self->tlb_tabpag = mmu_tabpag(self->mmu);
+  self->tlb_versao = self->tlb_tabpag == NULL ? 0
+                                              : tabpag_versao(self->tlb_tabpag);
+}
+
+// esvazia a TLB se a tabela de páginas mudou desde que foi preenchida
+static void jit__valida_tlb(jit_t *self)
+{
+  tabpag_t *tabpag = mmu_tabpag(self->mmu);
+  if (tabpag != self->tlb_tabpag
+      || (tabpag != NULL && tabpag_versao(tabpag) != self->tlb_versao)) {
+    jit__esvazia_tlb(self);
+  }
+}
+
+// lê o endereço virtual 'end' pela MMU, coloca o valor em estado->valor
+//   e a tradução na TLB
+// retorna 1 em caso de erro, com erro e complemento em estado
+static int jit__le(estado_t *estado, int end)
+{
+  estado->erro = mmu_le(estado->mmu, end, &estado->valor, usuario);
+  if (estado->erro != ERR_OK) {
+    estado->complemento = end;
+    return 1;
+  }
+  // endereços negativos não entram na TLB, o código gerado não os procura
+  if (end < 0) return 0;
+  int endfis;
+  mmu_traduz(estado->mmu, end, &endfis, usuario, PAG_LEITURA);
+  int inicio = endfis - DESLOC_DO_END(end);
+  mem_t *mem = mmu_mem(estado->mmu);
+  if (mem_ptr(mem, inicio + TAM_PAGINA - 1) == NULL) return 0;
+  entrada_tlb_t *entrada = &estado->tlb[PAGINA_DO_END(end) & (TAM_TLB - 1)];
+  entrada->pagina = PAGINA_DO_END(end);
+  entrada->base = mem_ptr(mem, inicio);
+  return 0;
+}
+
+// escreve 'valor' no endereço virtual 'end' pela MMU
+// retorna 1 em caso de erro, com erro e complemento em estado
+static int jit__escreve(estado_t *estado, int end, int valor)
+{
+  estado->erro = mmu_escreve(estado->mmu, end, valor, usuario);
+  if (estado->erro != ERR_OK) {
+    estado->complemento = end;
+    return 1;
+  }
+  return 0;
+}
+
+
+// ---------------------------------------------------------------------
+// EMISSÃO DE CÓDIGO x86-64
+
+// registradores do hospedeiro no código gerado:
+//   rbx - ponteiro para estado_t
+//   r12d - registrador A
+//   r13d - registrador X
+//   eax, ecx, edx, esi, edi - temporários
+
+#define DESL(campo) ((int32_t)offsetof(estado_t, campo))
+
+typedef struct {
+  uint8_t *p;
+} cod_t;
+
+static void emite(cod_t *c, int n, ...)
+{
+  va_list ap;
+  va_start(ap, n);
+  for (int i = 0; i < n; i++) {
+    *c->p++ = va_arg(ap, int);
+  }
+  va_end(ap);
+}
+
+static void emite4(cod_t *c, int32_t v)
+{
+  memcpy(c->p, &v, sizeof(v));
+  c->p += sizeof(v);
+}
+
+static void emite8(cod_t *c, uint64_t v)
+{
+  memcpy(c->p, &v, sizeof(v));
+  c->p += sizeof(v);
+}
+
+// emite um desvio condicional (0F 8x) ou incondicional (E9) para frente,
+//   retorna onde está o deslocamento, a ser corrigido com 'corrige'
+static uint8_t *emite_jcc(cod_t *c, int cc)
+{
+  emite(c, 2, 0x0F, cc);
+  emite4(c, 0);
+  return c->p - 4;
+}
+
+static uint8_t *emite_jmp(cod_t *c)
+{
+  emite(c, 1, 0xE9);
+  emite4(c, 0);
+  return c->p - 4;
+}
+
+// faz o desvio emitido em 'desl' vir para a posição atual
+static void corrige(cod_t *c, uint8_t *desl)
+{
+  int32_t v = c->p - (desl + 4);
+  memcpy(desl, &v, sizeof(v));
+}
+
+#define JO_Z  0x84
+#define JO_NZ 0x85
+#define JO_S  0x88
+
+static void emite_chamada(cod_t *c, void *funcao)
+{
+  emite(c, 2, 0x48, 0xB8);         // mov rax, funcao
+  emite8(c, (uint64_t)funcao);
+  emite(c, 2, 0xFF, 0xD0);         // call rax
+}
+
+static void emite_prologo(cod_t *c)
+{
+  emite(c, 1, 0x53);               // push rbx
+  emite(c, 2, 0x41, 0x54);         // push r12
+  emite(c, 2, 0x41, 0x55);         // push r13
+  emite(c, 3, 0x48, 0x89, 0xFB);   // mov rbx, rdi
+  emite(c, 3, 0x44, 0x8B, 0xA3);   // mov r12d, [rbx+A]
+  emite4(c, DESL(A));
+  emite(c, 3, 0x44, 0x8B, 0xAB);   // mov r13d, [rbx+X]
+  emite4(c, DESL(X));
+}
+
+// sai do bloco, retornando 'n' (o número de instruções executadas)
+// o PC já deve estar em estado
+static void emite_epilogo(cod_t *c, int n)
+{
+  emite(c, 3, 0x44, 0x89, 0xA3);   // mov [rbx+A], r12d
+  emite4(c, DESL(A));
+  emite(c, 3, 0x44, 0x89, 0xAB);   // mov [rbx+X], r13d
+  emite4(c, DESL(X));
+  emite(c, 1, 0xB8);               // mov eax, n
+  emite4(c, n);
+  emite(c, 2, 0x41, 0x5D);         // pop r13
+  emite(c, 2, 0x41, 0x5C);         // pop r12
+  emite(c, 1, 0x5B);               // pop rbx
+  emite(c, 1, 0xC3);               // ret
+}
+
+// sai do bloco com PC valendo 'pc'
+static void emite_saida(cod_t *c, int pc, int n)
+{
+  emite(c, 2, 0xC7, 0x83);         // mov dword [rbx+PC], pc
+  emite4(c, DESL(PC));
+  emite4(c, pc);
+  emite_epilogo(c, n);
+}
+
+// lê a memória no endereço virtual em eax, deixa o valor em eax
+// se der erro, sai do bloco com PC em 'pc' (a instrução que causou o erro)
+static void emite_le(cod_t *c, int pc, int n)
+{
+  emite(c, 2, 0x89, 0xC6);         // mov esi, eax
+  emite(c, 2, 0x85, 0xC0);         // test eax, eax
+  uint8_t *negativo = emite_jcc(c, JO_S);
+  emite(c, 2, 0x89, 0xC2);         // mov edx, eax
+  emite(c, 2, 0x81, 0xE2);         // and edx, TAM_PAGINA-1  (deslocamento)
+  emite4(c, TAM_PAGINA - 1);
+  emite(c, 2, 0xC1, 0xE8);         // shr eax, log2(TAM_PAGINA)  (página)
+  emite(c, 1, tabpag_bits_pagina);
+  emite(c, 2, 0x89, 0xC1);         // mov ecx, eax
+  emite(c, 2, 0x81, 0xE1);         // and ecx, TAM_TLB-1
+  emite4(c, TAM_TLB - 1);
+  emite(c, 3, 0xC1, 0xE1, 0x04);   // shl ecx, 4
+  emite(c, 3, 0x48, 0x01, 0xD9);   // add rcx, rbx
+  emite(c, 2, 0x3B, 0x81);         // cmp eax, [rcx+tlb.pagina]
+  emite4(c, DESL(tlb[0].pagina));
+  uint8_t *falta = emite_jcc(c, JO_NZ);
+  emite(c, 3, 0x48, 0x8B, 0x89);   // mov rcx, [rcx+tlb.base]
+  emite4(c, DESL(tlb[0].base));
+  emite(c, 3, 0x8B, 0x04, 0x91);   // mov eax, [rcx+rdx*4]
+  uint8_t *fim = emite_jmp(c);
+  // não está na TLB, lê pela MMU
+  corrige(c, negativo);
+  corrige(c, falta);
+  emite(c, 3, 0x48, 0x89, 0xDF);   // mov rdi, rbx
+  emite_chamada(c, jit__le);
+  emite(c, 2, 0x85, 0xC0);         // test eax, eax
+  uint8_t *ok = emite_jcc(c, JO_Z);
+  emite_saida(c, pc, n);
+  corrige(c, ok);
+  emite(c, 2, 0x8B, 0x83);         // mov eax, [rbx+valor]
+  emite4(c, DESL(valor));
+  corrige(c, fim);
+}
+
+// escreve na memória, no endereço virtual em eax, o valor que está em edx
+// se der erro, sai do bloco com PC em 'pc'; se a escrita descartou algum
+//   bloco, sai com PC em 'pc_seg' (que pode ser este, que já foi liberado
+//   mas continua na memória de código até ela ser esvaziada)
+static void emite_escreve(cod_t *c, int pc, int pc_seg, int n)
+{
+  emite(c, 2, 0x89, 0xC6);         // mov esi, eax
+  emite(c, 3, 0x48, 0x89, 0xDF);   // mov rdi, rbx
+  emite_chamada(c, jit__escreve);
+  emite(c, 2, 0x85, 0xC0);         // test eax, eax
+  uint8_t *ok = emite_jcc(c, JO_Z);
+  emite_saida(c, pc, n);
+  corrige(c, ok);
+  emite(c, 2, 0x83, 0xBB);         // cmp dword [rbx+invalidou], 0
+  emite4(c, DESL(invalidou));
+  emite(c, 1, 0x00);
+  uint8_t *continua = emite_jcc(c, JO_Z);
+  emite_saida(c, pc_seg, n);
+  corrige(c, continua);
+}
+
+// desvio condicional: PC = cond ? A1 : pc_seg
+static void emite_desvio_cond(cod_t *c, int cmov, int A1, int pc_seg, int n)
+{
+  emite(c, 3, 0x45, 0x85, 0xE4);   // test r12d, r12d
+  emite(c, 1, 0xB9);               // mov ecx, pc_seg
+  emite4(c, pc_seg);
+  emite(c, 1, 0xBA);               // mov edx, A1
+  emite4(c, A1);
+  emite(c, 3, 0x0F, cmov, 0xCA);   // cmovcc ecx, edx
+  emite(c, 2, 0x89, 0x8B);         // mov [rbx+PC], ecx
+  emite4(c, DESL(PC));
+  emite_epilogo(c, n);
+}
+
+// endereço do argumento em eax: A1 ou A1+X
+static void emite_end_A1(cod_t *c, int A1)
+{
+  emite(c, 1, 0xB8);               // mov eax, A1
+  emite4(c, A1);
+}
+
+static void emite_end_A1X(cod_t *c, int A1)
+{
+  emite(c, 3, 0x44, 0x89, 0xE8);   // mov eax, r13d
+  emite(c, 1, 0x05);               // add eax, A1
+  emite4(c, A1);
+}
+
+// as instruções que o JIT traduz
+static bool jit__traduzivel(int opcode)
+{
+  switch (opcode) {
+    case NOP: case CARGI: case CARGM: case CARGX: case ARMM: case ARMX:
+    case TRAX: case CPXA: case INCX: case SOMA: case SUB: case MULT:
+    case DIV: case RESTO: case NEG: case DESV: case DESVZ: case DESVNZ:
+    case DESVN: case DESVP: case CHAMA: case RET:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// emite o código de uma instrução em 'pc'; 'n' é o número de instruções
+//   executadas no bloco ao final dela
+// retorna true se a instrução termina o bloco
+static bool jit__emite_instrucao(cod_t *c, int opcode, int A1, int pc, int n)
+{
+  int pc_seg = pc + 1 + instrucao_num_args(opcode);
+  switch (opcode) {
+    case NOP:
+      break;
+    case CARGI:
+      emite(c, 2, 0x41, 0xBC);     // mov r12d, A1
+      emite4(c, A1);
+      break;
+    case CARGM:
+      emite_end_A1(c, A1);
+      emite_le(c, pc, n);
+      emite(c, 3, 0x41, 0x89, 0xC4);  // mov r12d, eax
+      break;
+    case CARGX:
+      emite_end_A1X(c, A1);
+      emite_le(c, pc, n);
+      emite(c, 3, 0x41, 0x89, 0xC4);  // mov r12d, eax
+      break;
+    case ARMM:
+    case ARMX:
+      if (opcode == ARMM) {
+        emite_end_A1(c, A1);
+      } else {
+        emite_end_A1X(c, A1);
+      }
+      emite(c, 3, 0x44, 0x89, 0xE2);  // mov edx, r12d
+      emite_escreve(c, pc, pc_seg, n);
+      break;
+    case TRAX:
+      emite(c, 3, 0x45, 0x87, 0xEC);  // xchg r12d, r13d
+      break;
+    case CPXA:
+      emite(c, 3, 0x45, 0x89, 0xEC);  // mov r12d, r13d
+      break;
+    case INCX:
+      emite(c, 4, 0x41, 0x83, 0xC5, 0x01);  // add r13d, 1
+      break;
+    case SOMA:
+      emite_end_A1(c, A1);
+      emite_le(c, pc, n);
+      emite(c, 3, 0x41, 0x01, 0xC4);  // add r12d, eax
+      break;
+    case SUB:
+      emite_end_A1(c, A1);
+      emite_le(c, pc, n);
+      emite(c, 3, 0x41, 0x29, 0xC4);  // sub r12d, eax
+      break;
+    case MULT:
+      emite_end_A1(c, A1);
+      emite_le(c, pc, n);
+      emite(c, 4, 0x44, 0x0F, 0xAF, 0xE0);  // imul r12d, eax
+      break;
+    case DIV:
+    case RESTO:
+      emite_end_A1(c, A1);
+      emite_le(c, pc, n);
+      emite(c, 2, 0x89, 0xC1);        // mov ecx, eax
+      emite(c, 3, 0x44, 0x89, 0xE0);  // mov eax, r12d
+      emite(c, 1, 0x99);              // cdq
+      emite(c, 2, 0xF7, 0xF9);        // idiv ecx
+      if (opcode == DIV) {
+        emite(c, 3, 0x41, 0x89, 0xC4);  // mov r12d, eax
+      } else {
+        emite(c, 3, 0x41, 0x89, 0xD4);  // mov r12d, edx
+      }
+      break;
+    case NEG:
+      emite(c, 3, 0x41, 0xF7, 0xDC);  // neg r12d
+      break;
+    case DESV:
+      emite_saida(c, A1, n);
+      return true;
+    case DESVZ:
+      emite_desvio_cond(c, 0x44, A1, pc_seg, n);  // cmovz
+      return true;
+    case DESVNZ:
+      emite_desvio_cond(c, 0x45, A1, pc_seg, n);  // cmovnz
+      return true;
+    case DESVN:
+      emite_desvio_cond(c, 0x4C, A1, pc_seg, n);  // cmovl
+      return true;
+    case DESVP:
+      emite_desvio_cond(c, 0x4F, A1, pc_seg, n);  // cmovg
+      return true;
+    case CHAMA:
+      emite_end_A1(c, A1);
+      emite(c, 1, 0xBA);              // mov edx, pc_seg
+      emite4(c, pc_seg);
+      emite_escreve(c, pc, A1 + 1, n);
+      emite_saida(c, A1 + 1, n);
+      return true;
+    case RET:
+      emite_end_A1(c, A1);
+      emite_le(c, pc, n);
+      emite(c, 2, 0x89, 0x83);        // mov [rbx+PC], eax
+      emite4(c, DESL(PC));
+      emite_epilogo(c, n);
+      return true;
+  }
+  return false;
+}
+
+
+// ---------------------------------------------------------------------
+// TRADUÇÃO E EXECUÇÃO DE BLOCOS
+
+// descarta todos os blocos traduzidos e libera a memória de código
+static void jit__esvazia_codigo(jit_t *self)
+{
+  for (int i = 0; i < TAM_TAB_BLOCOS; i++) {
+    self->blocos[i].end = -1;
+  }
+  self->codigo_usado = 0;
+  self->n_esvaziamentos++;
+}
+
+// traduz o bloco descrito em 'bloco' (end e pc); preenche o resto da entrada
+// as instruções são lidas da memória física; o bloco não passa do fim
+//   do quadro onde inicia
+// retorna false se não dá para traduzir (a primeira instrução não é
+//   traduzível)
+static bool jit__traduz(jit_t *self, bloco_t *bloco)
+{
+  if (self->codigo_usado + MAX_BYTES_BLOCO > TAM_CODIGO) {
+    int end = bloco->end, pc = bloco->pc;
+    jit__esvazia_codigo(self);
+    bloco->end = end;
+    bloco->pc = pc;
+  }
+  mem_t *mem = mmu_mem(self->mmu);
+  int ultimo = bloco->end | (TAM_PAGINA - 1);
+  cod_t c = { self->codigo + self->codigo_usado };
+  emite_prologo(&c);
+  int end = bloco->end;
+  int pc = bloco->pc;
+  int n = 0;
+  bool terminou = false;
+  while (!terminou && n < MAX_INSTR_BLOCO
+         && end - bloco->end < MAX_PALAVRAS_BLOCO) {
+    int opcode, A1 = 0;
+    if (mem_le(mem, end, &opcode) != ERR_OK) break;
+    if (!jit__traduzivel(opcode)) break;
+    int n_args = instrucao_num_args(opcode);
+    if (end + n_args > ultimo) break;
+    if (n_args > 0 && mem_le(mem, end + 1, &A1) != ERR_OK) break;
+    n++;
+    terminou = jit__emite_instrucao(&c, opcode, A1, pc, n);
+    end += 1 + n_args;
+    pc += 1 + n_args;
+  }
+  if (n == 0) return false;
+  if (!terminou) {
+    emite_saida(&c, pc, n);
+  }
+  bloco->codigo = (codigo_t)(self->codigo + self->codigo_usado);
+  bloco->tam = end - bloco->end;
+  bloco->n_instr = n;
+  self->codigo_usado = c.p - self->codigo;
+  self->n_traduzidos++;
+  return true;
+}
+
+// retorna o bloco traduzido que inicia em 'endfis' (que corresponde
+//   ao endereço virtual 'pc'), ou NULL se não houver (ainda)
+static bloco_t *jit__acha_bloco(jit_t *self, int endfis, int pc)
+{
+  bloco_t *bloco = &self->blocos[endfis & (TAM_TAB_BLOCOS - 1)];
+  if (bloco->end != endfis || bloco->pc != pc) {
+    bloco->end = endfis;
+    bloco->pc = pc;
+    bloco->tam = 1;
+    bloco->contador = 0;
+    bloco->codigo = NULL;
+  }
+  if (bloco->codigo != NULL) return bloco;
+  if (bloco->contador < 0) return NULL;
+  if (++bloco->contador < LIMIAR_JIT) return NULL;
+  if (!jit__traduz(self, bloco)) {
+    bloco->contador = -1;
+    return NULL;
+  }
+  return bloco;
+}
+
+int jit_executa(jit_t *self, jit_regs_t *regs, cpu_modo_t modo, int n)
+{
+  if (modo != usuario) return 0;
+  int endfis;
+  if (mmu_traduz(self->mmu, regs->PC, &endfis, modo, PAG_EXECUCAO)
+      != ERR_OK) {
+    return 0;
+  }
+  bloco_t *bloco = jit__acha_bloco(self, endfis, regs->PC);
+  if (bloco == NULL || bloco->n_instr > n) return 0;
+
+  jit__valida_tlb(self);
+  estado_t *estado = &self->estado;
+  estado->PC = regs->PC;
+  estado->A = regs->A;
+  estado->X = regs->X;
+  estado->erro = ERR_OK;
+  estado->invalidou = 0;
+  self->executando = true;
+  int feitas = bloco->codigo(estado);
+  self->executando = false;
+  regs->PC = estado->PC;
+  regs->A = estado->A;
+  regs->X = estado->X;
+  if (estado->erro != ERR_OK) {
+    regs->erro = estado->erro;
+    regs->complemento = estado->complemento;
+  }
+  self->n_execucoes++;
+  self->n_instr += feitas;
+  return feitas;
+}
+
+void jit_invalida(jit_t *self, int endereco, int n)
+{
+  // como na cache de instruções da CPU, cada entrada da tabela é vista
+  //   no máximo uma vez
+  int fim = endereco + n - 1;
+  int inicio = endereco - MAX_PALAVRAS_BLOCO + 1;
+  if (fim - inicio >= TAM_TAB_BLOCOS) inicio = fim - TAM_TAB_BLOCOS + 1;
+  for (int end = inicio; end <= fim; end++) {
+    if (end < 0) continue;
+    bloco_t *bloco = &self->blocos[end & (TAM_TAB_BLOCOS - 1)];
+    if (bloco->end != -1 && bloco->end <= fim
+        && bloco->end + bloco->tam > endereco) {
+      if (bloco->codigo != NULL) {
+        self->n_invalidados++;
+        if (self->executando) self->estado.invalidou = 1;
+      }
+      bloco->end = -1;
+    }
+  }
+}
+
+void jit_relatorio(jit_t *self, FILE *arq)
+{
+  fprintf(arq, "JIT: %ld blocos traduzidos, %ld descartados, "
+               "%ld esvaziamentos da memória de código\n",
+          self->n_traduzidos, self->n_invalidados, self->n_esvaziamentos);
+  fprintf(arq, "JIT: %ld execuções de blocos, %ld instruções\n",
+          self->n_execucoes, self->n_instr);
+}
@@ -0,0 +1,56 @@
+#ifndef JIT_H
+#define JIT_H
+
+// tradutor dinâmico (JIT) de código da CPU simulada para código nativo
+//   x86-64, usado opcionalmente pela CPU (compile com 'make DESPACHO=jit')
+// conta quantas vezes a execução passa por cada endereço que inicia um
+//   bloco básico; quando passa de um limiar, traduz o bloco para código
+//   nativo, que executa as instruções do bloco sem passar pelo interpretador
+// um bloco termina em um desvio ou antes de uma instrução que precisa do
+//   interpretador (E/S, chamadas de sistema, instruções privilegiadas);
+//   não passa do fim de um quadro, para que uma só tradução do PC sirva
+//   para o bloco todo
+// só executa código em modo usuário
+
+#include "err.h"
+#include "mmu.h"
+#include "cpu_modo.h"
+#include <stdio.h>
+
+typedef struct jit_t jit_t;
+
+// os registradores da CPU, trocados entre a CPU e o JIT
+typedef struct {
+  int PC;
+  int A;
+  int X;
+  err_t erro;
+  int complemento;
+} jit_regs_t;
+
+// cria um JIT que acessa a memória através da MMU fornecida
+// retorna NULL em caso de erro (por exemplo, se não conseguir memória
+//   executável no hospedeiro)
+jit_t *jit_cria(mmu_t *mmu);
+
+// destrói o JIT
+void jit_destroi(jit_t *self);
+
+// executa o bloco traduzido que inicia no PC em 'regs', se houver e se
+//   tiver no máximo 'n' instruções
+// retorna o número de instruções executadas, 0 se não executou nada (a CPU
+//   deve interpretar a próxima instrução)
+// se uma instrução do bloco causar erro, a execução para nela, com o PC
+//   apontando para ela e erro e complemento em 'regs', como no interpretador
+int jit_executa(jit_t *self, jit_regs_t *regs, cpu_modo_t modo, int n);
+
+// informa que os 'n' endereços físicos a partir de 'endereco' foram
+//   alterados
+// os blocos traduzidos que incluem algum desses endereços são descartados;
+//   se for o bloco em execução, ele termina logo após a instrução que alterou
+void jit_invalida(jit_t *self, int endereco, int n);
+
+// imprime em 'arq' as estatísticas do JIT
+void jit_relatorio(jit_t *self, FILE *arq);
+
+#endif // JIT_H
@@ -2,6 +2,7 @@
 #include "programa.h"
 #include "memoria.h"
 #include "mmu.h"
+#include "tabpag.h"
 #include "cpu.h"
 #include "relogio.h"
 #include "console.h"
@@ -9,9 +10,20 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 // constantes
-#define MEM_TAM 10000 // tamanho da memória principal
+#define MEM_TAM 10000 // tamanho padrão das memórias principal e secundária
+
+// tamanho das memórias, pode ser alterado na linha de comando
+static int tam_mem = MEM_TAM;
+static int tam_mem_secundaria = MEM_TAM;
+// política de substituição de páginas do SO, pode ser alterada na linha de
+//   comando
+static subst_politica_t politica = SUBST_PADRAO;
+// limpador de páginas do SO, pode ser alterado na linha de comando
+static int orcamento_limpeza = SO_LIMPEZA_ORCAMENTO;
+static int reserva_limpeza = SO_LIMPEZA_RESERVA;
 
 typedef struct
 {
@@ -28,8 +40,8 @@ typedef struct
 void cria_hardware(hardware_t *hw)
 {
   // cria a memória e a MMU
-  hw->mem = mem_cria(MEM_TAM);
-  hw->mem_secundaria = mem_cria(MEM_TAM);
+  hw->mem = mem_cria(tam_mem);
+  hw->mem_secundaria = mem_cria(tam_mem_secundaria);
   hw->mmu = mmu_cria(hw->mem);
 
   // cria dispositivos de E/S
@@ -59,32 +71,135 @@ void cria_hardware(hardware_t *hw)
   hw->controle = controle_cria(hw->cpu, hw->console, hw->relogio);
 }
 
-void destroi_hardware(hardware_t *hw)
+// destrói o hardware, e também o SO, que precisa dele
+void destroi_hardware(hardware_t *hw, so_t *so)
 {
   controle_destroi(hw->controle);
+  // a console é destruída antes, para que os relatórios saiam no terminal
+  //   normal, depois que o curses terminar
+  console_destroi(hw->console);
+  so_relatorio(so, stderr);
+  so_destroi(so);
+  cpu_relatorio(hw->cpu, stderr);
+#ifdef CPU_PERFIL
+  FILE *csv = fopen("perfil.csv", "w");
+  if (csv != NULL) {
+    cpu_perfil_csv(hw->cpu, csv);
+    fclose(csv);
+  }
+#endif
   cpu_destroi(hw->cpu);
+  mmu_relatorio(hw->mmu, stderr);
+  fprintf(stderr, "MEM: principal: %d de %d posições ocupadas no hospedeiro; "
+                  "secundária: %d de %d\n",
+          mem_tam_ocupado(hw->mem), mem_tam(hw->mem),
+          mem_tam_ocupado(hw->mem_secundaria), mem_tam(hw->mem_secundaria));
   es_destroi(hw->es);
   rel_destroi(hw->relogio);
-  console_destroi(hw->console);
   mmu_destroi(hw->mmu);
   mem_destroi(hw->mem);
+  mem_destroi(hw->mem_secundaria);
 }
 
-int main()
+// converte 'str' para um tamanho positivo em '*ptam'
+// retorna false se não for um número positivo
+static bool converte_tam(char *str, int *ptam)
+{
+  char *fim;
+  long tam = strtol(str, &fim, 10);
+  if (*fim != '\0' || tam <= 0 || tam > 0x7fffffff) return false;
+  *ptam = tam;
+  return true;
+}
+
+// converte 'str' para um número não negativo em '*pnum'
+// retorna false se não for
+static bool converte_num(char *str, int *pnum)
+{
+  char *fim;
+  long num = strtol(str, &fim, 10);
+  if (*fim != '\0' || *str == '\0' || num < 0 || num > 0x7fffffff) {
+    return false;
+  }
+  *pnum = num;
+  return true;
+}
+
+// trata os argumentos da linha de comando:
+//   -p tam  tamanho das páginas, em palavras (potência de 2, entre
+//           TAM_PAGINA_MIN e TAM_PAGINA_MAX; padrão TAM_PAGINA_PADRAO)
+//   -m tam  tamanho da memória principal, em palavras (padrão MEM_TAM)
+//   -s tam  tamanho da memória secundária, em palavras (padrão MEM_TAM)
+//   -r pol  política de substituição de páginas (fifo, relogio, nru ou
+//           envelhecimento; padrão SUBST_PADRAO)
+//   -l n    páginas que o limpador de páginas do SO pode gravar a cada
+//           interrupção do relógio (0 desliga; padrão SO_LIMPEZA_ORCAMENTO)
+//   -f n    quadros livres que o limpador tenta manter (padrão
+//           SO_LIMPEZA_RESERVA)
+// retorna false se houver algum argumento inválido
+static bool trata_argumentos(int argc, char *argv[])
+{
+  for (int i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-m") == 0 || strcmp(argv[i], "-s") == 0)
+        && i + 1 < argc) {
+      int *ptam = argv[i][1] == 'm' ? &tam_mem : &tam_mem_secundaria;
+      if (!converte_tam(argv[++i], ptam)) {
+        fprintf(stderr, "tamanho de memória inválido: '%s'\n", argv[i]);
+        return false;
+      }
+    } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+      char *fim;
+      long tam = strtol(argv[++i], &fim, 10);
+      if (*fim != '\0' || !tabpag_define_tam_pagina(tam)) {
+        fprintf(stderr, "tamanho de página inválido: '%s' (potência de 2"
+                " entre %d e %d)\n", argv[i], TAM_PAGINA_MIN, TAM_PAGINA_MAX);
+        return false;
+      }
+    } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+      if (!subst_politica_do_nome(argv[++i], &politica)) {
+        fprintf(stderr, "política de substituição inválida: '%s' (",
+                argv[i]);
+        for (int p = 0; p < N_SUBST; p++) {
+          fprintf(stderr, "%s%s", p == 0 ? "" : ", ", subst_nome(p));
+        }
+        fprintf(stderr, ")\n");
+        return false;
+      }
+    } else if ((strcmp(argv[i], "-l") == 0 || strcmp(argv[i], "-f") == 0)
+               && i + 1 < argc) {
+      int *pnum = argv[i][1] == 'l' ? &orcamento_limpeza : &reserva_limpeza;
+      if (!converte_num(argv[++i], pnum)) {
+        fprintf(stderr, "número inválido para o limpador: '%s'\n", argv[i]);
+        return false;
+      }
+    } else {
+      fprintf(stderr, "uso: %s [-p tam_pagina] [-m tam_mem] [-s tam_mem_sec]"
+                      " [-r politica] [-l orcamento] [-f reserva]\n",
+              argv[0]);
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char *argv[])
 {
   hardware_t hw;
   so_t *so;
 
+  if (!trata_argumentos(argc, argv)) return 1;
+
   // cria o hardware
   cria_hardware(&hw);
   // cria o sistema operacional
-  so = so_cria(hw.cpu, hw.mem, hw.mem_secundaria, hw.mmu, hw.console, hw.relogio);
+  so = so_cria(hw.cpu, hw.mem, hw.mem_secundaria, hw.mmu, hw.console, hw.relogio,
+               politica);
+  so_define_limpeza(so, orcamento_limpeza, reserva_limpeza);
 
   // executa o laço de execução da CPU
   controle_laco(hw.controle);
 
   // destroi tudo
-  so_destroi(so);
-  destroi_hardware(&hw);
+  destroi_hardware(&hw, so);
   return 0;
 }
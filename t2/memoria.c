@@ -1,20 +1,37 @@
 #include "memoria.h"
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 // tipo de dados opaco para representar uma região de memória
 struct mem_t {
   int tam;
   int *conteudo;
+  // quem deve ser avisado das alterações
+  mem_f_alteracao_t obs_alteracao;
+  void *arg_obs;
 };
 
+// número de bytes reservados para 'tam' valores
+static size_t bytes_reservados(int tam)
+{
+  return (size_t)(tam > 0 ? tam : 1) * sizeof(int);
+}
+
 mem_t *mem_cria(int tam)
 {
   mem_t *self;
   self = malloc(sizeof(*self));
   if (self != NULL) {
     self->tam = tam;
-    self->conteudo = malloc(tam * sizeof(*(self->conteudo)));
-    if (self->conteudo == NULL) {
+    self->obs_alteracao = NULL;
+    self->arg_obs = NULL;
+    // a reserva não ocupa memória: o sistema só aloca cada página (zerada)
+    //   quando ela for acessada
+    self->conteudo = mmap(NULL, bytes_reservados(tam), PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (self->conteudo == MAP_FAILED) {
       free(self);
       self = NULL;
     }
@@ -25,9 +42,7 @@ mem_t *mem_cria(int tam)
 void mem_destroi(mem_t *self)
 {
   if (self != NULL) {
-    if (self->conteudo != NULL) {
-      free(self->conteudo);
-    }
+    munmap(self->conteudo, bytes_reservados(self->tam));
     free(self);
   }
 }
@@ -37,6 +52,22 @@ int mem_tam(mem_t *self)
   return self->tam;
 }
 
+int mem_tam_ocupado(mem_t *self)
+{
+  size_t tam_pag = sysconf(_SC_PAGESIZE);
+  size_t n_pag = (bytes_reservados(self->tam) + tam_pag - 1) / tam_pag;
+  unsigned char *residente = malloc(n_pag);
+  if (residente == NULL) return -1;
+  long ocupado = 0;
+  if (mincore(self->conteudo, bytes_reservados(self->tam), residente) == 0) {
+    for (size_t i = 0; i < n_pag; i++) {
+      if (residente[i] & 1) ocupado += tam_pag / sizeof(int);
+    }
+  }
+  free(residente);
+  return ocupado < self->tam ? ocupado : self->tam;
+}
+
 // função auxiliar, verifica se endereço é válido
 static err_t verif_permissao(mem_t *self, int endereco)
 {
@@ -46,6 +77,24 @@ static err_t verif_permissao(mem_t *self, int endereco)
   return ERR_OK;
 }
 
+// função auxiliar, verifica se os 'n' endereços a partir de 'endereco'
+//   são válidos
+static err_t verif_bloco(mem_t *self, int endereco, int n)
+{
+  if (n < 0 || endereco < 0 || endereco > self->tam - n) {
+    return ERR_END_INV;
+  }
+  return ERR_OK;
+}
+
+// função auxiliar, avisa o observador da alteração de 'n' posições
+static void avisa_alteracao(mem_t *self, int endereco, int n)
+{
+  if (self->obs_alteracao != NULL && n > 0) {
+    self->obs_alteracao(self->arg_obs, endereco, n);
+  }
+}
+
 err_t mem_le(mem_t *self, int endereco, int *pvalor)
 {
   err_t err = verif_permissao(self, endereco);
@@ -60,6 +109,70 @@ err_t mem_escreve(mem_t *self, int endereco, int valor)
   err_t err = verif_permissao(self, endereco);
   if (err == ERR_OK) {
     self->conteudo[endereco] = valor;
+    avisa_alteracao(self, endereco, 1);
   }
   return err;
 }
+
+err_t mem_le_bloco(mem_t *self, int endereco, int *pvalores, int n)
+{
+  err_t err = verif_bloco(self, endereco, n);
+  if (err == ERR_OK) {
+    memcpy(pvalores, &self->conteudo[endereco], n * sizeof(int));
+  }
+  return err;
+}
+
+err_t mem_escreve_bloco(mem_t *self, int endereco, const int *valores, int n)
+{
+  err_t err = verif_bloco(self, endereco, n);
+  if (err == ERR_OK) {
+    memcpy(&self->conteudo[endereco], valores, n * sizeof(int));
+    avisa_alteracao(self, endereco, n);
+  }
+  return err;
+}
+
+err_t mem_copia(mem_t *dest, int end_dest, mem_t *orig, int end_orig, int n)
+{
+  if (verif_bloco(orig, end_orig, n) != ERR_OK
+      || verif_bloco(dest, end_dest, n) != ERR_OK) {
+    return ERR_END_INV;
+  }
+  memmove(&dest->conteudo[end_dest], &orig->conteudo[end_orig],
+          n * sizeof(int));
+  avisa_alteracao(dest, end_dest, n);
+  return ERR_OK;
+}
+
+err_t mem_preenche(mem_t *self, int endereco, int valor, int n)
+{
+  err_t err = verif_bloco(self, endereco, n);
+  if (err == ERR_OK) {
+    // laço simples, que o compilador vetoriza
+    int *p = &self->conteudo[endereco];
+    for (int i = 0; i < n; i++) {
+      p[i] = valor;
+    }
+    avisa_alteracao(self, endereco, n);
+  }
+  return err;
+}
+
+void mem_escreve_valido(mem_t *self, int endereco, int valor)
+{
+  self->conteudo[endereco] = valor;
+  avisa_alteracao(self, endereco, 1);
+}
+
+int *mem_ptr(mem_t *self, int endereco)
+{
+  if (verif_permissao(self, endereco) != ERR_OK) return NULL;
+  return &self->conteudo[endereco];
+}
+
+void mem_define_obs_alteracao(mem_t *self, mem_f_alteracao_t func, void *arg)
+{
+  self->obs_alteracao = func;
+  self->arg_obs = arg;
+}
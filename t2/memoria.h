@@ -3,6 +3,11 @@
 
 // simulador da memória principal
 // é um vetor de inteiros
+// o vetor é reservado inteiro na criação, mas só ocupa memória do
+//   hospedeiro à medida que é usado (por páginas do hospedeiro, na primeira
+//   escrita); posições nunca escritas valem 0
+// assim, memórias muito grandes (centenas de milhões de posições) só
+//   custam o que for realmente usado
 
 #include "err.h"
 
@@ -22,6 +27,11 @@ void mem_destroi(mem_t *self);
 // retorna o tamanho da região de memória (número de valores que comporta)
 int mem_tam(mem_t *self);
 
+// retorna quantas posições da região estão ocupando memória do hospedeiro
+// (sempre múltiplo do número de posições em uma página do hospedeiro,
+//   limitado a mem_tam), ou -1 em caso de erro
+int mem_tam_ocupado(mem_t *self);
+
 // coloca na posição apontada por 'pvalor' o valor no endereço 'endereco'
 // retorna erro ERR_END_INV (e não altera '*pvalor') se endereço inválido
 err_t mem_le(mem_t *self, int endereco, int *pvalor);
@@ -30,4 +40,47 @@ err_t mem_le(mem_t *self, int endereco, int *pvalor);
 // retorna erro ERR_END_INV se endereço inválido
 err_t mem_escreve(mem_t *self, int endereco, int valor);
 
+// operações em blocos de 'n' posições consecutivas, que verificam os
+//   endereços uma só vez e copiam tudo de uma vez
+// retornam ERR_END_INV (e não fazem nada) se algum endereço for inválido
+// o observador de alterações (ver abaixo) é chamado uma vez por bloco
+
+// copia para 'pvalores' os valores nos endereços a partir de 'endereco'
+err_t mem_le_bloco(mem_t *self, int endereco, int *pvalores, int n);
+
+// copia os valores de 'valores' para os endereços a partir de 'endereco'
+err_t mem_escreve_bloco(mem_t *self, int endereco, const int *valores, int n);
+
+// copia as posições a partir de 'end_orig' em 'orig' para as posições a
+//   partir de 'end_dest' em 'dest' (podem ser a mesma memória, inclusive
+//   com os blocos sobrepostos)
+err_t mem_copia(mem_t *dest, int end_dest, mem_t *orig, int end_orig, int n);
+
+// coloca 'valor' nas posições a partir de 'endereco'
+err_t mem_preenche(mem_t *self, int endereco, int valor, int n);
+
+// retorna um ponteiro para a posição 'endereco' da memória, ou NULL se o
+//   endereço for inválido
+// permite acesso direto, sem verificação, a quem precisa de desempenho (o
+//   JIT da CPU); escritas feitas assim não são informadas ao observador
+//   de alterações (ver abaixo)
+int *mem_ptr(mem_t *self, int endereco);
+
+// escreve 'valor' no endereço 'endereco', sem verificar o endereço
+// para quem já garantiu que ele é válido (a MMU, com um endereço traduzido
+//   pela tabela de páginas); o observador de alterações é avisado
+// para ler sem verificação, use o ponteiro retornado por mem_ptr(self, 0)
+void mem_escreve_valido(mem_t *self, int endereco, int valor);
+
+// tipo da função chamada quando posições da memória são alteradas (as 'n'
+//   a partir de 'endereco')
+typedef void (*mem_f_alteracao_t)(void *arg, int endereco, int n);
+
+// define uma função a ser chamada (com o argumento 'arg') após cada escrita
+//   bem sucedida na memória, com os endereços alterados
+// usado pela CPU para descartar instruções pré-decodificadas que foram
+//   sobrescritas
+// se 'func' for NULL, nenhuma função é chamada
+void mem_define_obs_alteracao(mem_t *self, mem_f_alteracao_t func, void *arg);
+
 #endif // MEMORIA_H
@@ -1,19 +1,77 @@
 #include "mmu.h"
 #include <stdlib.h>
 
+// TLB: guarda as últimas traduções de página em quadro, de várias tabelas
+//   de páginas (identificadas pelo ASID), para não consultar a tabela a
+//   cada acesso
+// é associativa por conjunto: a página só pode estar em um dos TLB_VIAS
+//   lugares do conjunto que corresponde a ela (com TLB_VIAS 1 é de
+//   mapeamento direto); dentro do conjunto, a substituição é circular
+// os tamanhos podem ser alterados na compilação (ver Makefile)
+// número de conjuntos, tem que ser potência de 2
+#ifndef TLB_CONJUNTOS
+#define TLB_CONJUNTOS 16
+#endif
+// número de entradas em cada conjunto
+#ifndef TLB_VIAS
+#define TLB_VIAS 4
+#endif
+
+// uma entrada da TLB
+// a entrada guarda as permissões de acesso à página, e também lembra se os
+//   bits de acesso e alteração da página já foram marcados na tabela, para
+//   só marcar no primeiro acesso; a tabela avisa a MMU quando zera um desses
+//   bits ou altera a tradução ou a proteção da página, e a entrada é
+//   descartada
+typedef struct {
+  unsigned asid;   // 0 se a entrada não é válida
+  int pagina;
+  int quadro;
+  int prot;        // permissões de acesso (PAG_LEITURA etc)
+  bool acessada;
+  bool alterada;
+} tlb_entrada_t;
+
 // tipo de dados opaco para representar uma MMU
 struct mmu_t {
   mem_t *mem;
+  // conteúdo da memória, para ler sem verificação os endereços físicos
+  //   traduzidos pela tabela de páginas, que são sempre válidos
+  int *palavras;
   tabpag_t *tabpag;
+  unsigned asid;
+  tlb_entrada_t tlb[TLB_CONJUNTOS][TLB_VIAS];
+  int proxima[TLB_CONJUNTOS];  // próxima via a substituir em cada conjunto
+  long n_acertos;
+  long n_faltas;
+  long n_substituicoes;        // entradas válidas substituídas
+  long n_derrubadas;           // entradas descartadas por alteração na tabela
 };
 
+// função auxiliar, chamada pela tabela de páginas quando uma página é alterada
+static void mmu__derruba(void *arg, tabpag_t *tabpag, int pagina);
+
 mmu_t *mmu_cria(mem_t *mem)
 {
   mmu_t *self;
   self = malloc(sizeof(*self));
   if (self != NULL) {
+    // as tabelas de páginas só vão aceitar quadros desta memória
+    tabpag_define_memoria(mem_tam(mem));
     self->mem = mem;
+    self->palavras = mem_ptr(mem, 0);
     self->tabpag = NULL;
+    self->asid = 0;
+    for (int c = 0; c < TLB_CONJUNTOS; c++) {
+      for (int v = 0; v < TLB_VIAS; v++) {
+        self->tlb[c][v].asid = 0;
+      }
+      self->proxima[c] = 0;
+    }
+    self->n_acertos = 0;
+    self->n_faltas = 0;
+    self->n_substituicoes = 0;
+    self->n_derrubadas = 0;
   }
   return self;
 }
@@ -21,29 +79,153 @@ mmu_t *mmu_cria(mem_t *mem)
 void mmu_destroi(mmu_t *self)
 {
   if (self != NULL) {
+    if (self->tabpag != NULL) {
+      tabpag_define_obs_alteracao(self->tabpag, NULL, NULL);
+    }
     free(self);
   }
 }
 
+void mmu_relatorio(mmu_t *self, FILE *arq)
+{
+  long n = self->n_acertos + self->n_faltas;
+  fprintf(arq, "MMU: TLB de %d entradas (%d conjuntos de %d vias): "
+               "%ld acertos, %ld faltas (%.2f%% de acertos)\n",
+          TLB_CONJUNTOS * TLB_VIAS, TLB_CONJUNTOS, TLB_VIAS,
+          self->n_acertos, self->n_faltas,
+          n == 0 ? 0.0 : 100.0 * self->n_acertos / n);
+  fprintf(arq, "MMU: TLB: %ld substituições, %ld entradas descartadas por "
+               "alteração na tabela\n", self->n_substituicoes,
+          self->n_derrubadas);
+}
+
+mem_t *mmu_mem(mmu_t *self)
+{
+  return self->mem;
+}
+
+tabpag_t *mmu_tabpag(mmu_t *self)
+{
+  return self->tabpag;
+}
+
 void mmu_define_tabpag(mmu_t *self, tabpag_t *tabpag)
 {
+  // as entradas da TLB de outras tabelas continuam, identificadas pelo ASID
   self->tabpag = tabpag;
+  if (tabpag == NULL) {
+    self->asid = 0;
+    return;
+  }
+  self->asid = tabpag_asid(tabpag);
+  tabpag_define_obs_alteracao(tabpag, mmu__derruba, self);
+}
+
+// ---------------------------------------------------------------------
+// TLB
+
+// conjunto da TLB onde fica a página 'pagina' da tabela 'asid'
+static int mmu__conjunto(unsigned asid, int pagina)
+{
+  return ((unsigned)pagina ^ asid) & (TLB_CONJUNTOS - 1);
+}
+
+// retorna a entrada da TLB com a tradução da página, NULL se não tiver
+static tlb_entrada_t *mmu__tlb_busca(mmu_t *self, unsigned asid, int pagina)
+{
+  tlb_entrada_t *conj = self->tlb[mmu__conjunto(asid, pagina)];
+  for (int v = 0; v < TLB_VIAS; v++) {
+    if (conj[v].asid == asid && conj[v].pagina == pagina) return &conj[v];
+  }
+  return NULL;
+}
+
+// coloca na TLB a tradução da página da tabela em uso para 'quadro'
+static tlb_entrada_t *mmu__tlb_insere(mmu_t *self, int pagina, int quadro,
+                                      int prot)
+{
+  int c = mmu__conjunto(self->asid, pagina);
+  tlb_entrada_t *conj = self->tlb[c];
+  tlb_entrada_t *entrada = NULL;
+  for (int v = 0; v < TLB_VIAS; v++) {
+    if (conj[v].asid == 0) {
+      entrada = &conj[v];
+      break;
+    }
+  }
+  if (entrada == NULL) {
+    entrada = &conj[self->proxima[c]];
+    self->proxima[c] = (self->proxima[c] + 1) % TLB_VIAS;
+    self->n_substituicoes++;
+  }
+  entrada->asid = self->asid;
+  entrada->pagina = pagina;
+  entrada->quadro = quadro;
+  entrada->prot = prot;
+  entrada->acessada = false;
+  entrada->alterada = false;
+  return entrada;
 }
 
+static void mmu__derruba(void *arg, tabpag_t *tabpag, int pagina)
+{
+  mmu_t *self = arg;
+  tlb_entrada_t *entrada = mmu__tlb_busca(self, tabpag_asid(tabpag), pagina);
+  if (entrada != NULL) {
+    entrada->asid = 0;
+    self->n_derrubadas++;
+  }
+}
+
+// traduz 'endvirt' pela TLB ou, se não estiver nela, pela tabela em uso,
+//   para um acesso do tipo 'acesso' (PAG_LEITURA, PAG_ESCRITA ou
+//   PAG_EXECUCAO)
+// retorna a entrada da TLB usada, com o endereço físico em '*pendfis', ou
+//   NULL em caso de erro, com o erro em '*perr' (ERR_PROT se a página não
+//   permite o acesso)
+static tlb_entrada_t *mmu__traduz(mmu_t *self, int endvirt, int *pendfis,
+                                  err_t *perr, int acesso)
+{
+  int pagina = PAGINA_DO_END(endvirt);
+  tlb_entrada_t *entrada = mmu__tlb_busca(self, self->asid, pagina);
+  if (entrada != NULL) {
+    self->n_acertos++;
+  } else {
+    self->n_faltas++;
+    int endfis;
+    *perr = tabpag_traduz(self->tabpag, endvirt, &endfis);
+    if (*perr != ERR_OK) return NULL;
+    entrada = mmu__tlb_insere(self, pagina, PAGINA_DO_END(endfis),
+                              tabpag_protecao(self->tabpag, pagina));
+  }
+  if ((entrada->prot & acesso) == 0) {
+    *perr = ERR_PROT;
+    return NULL;
+  }
+  *pendfis = END_DA_PAGINA(entrada->quadro) | DESLOC_DO_END(endvirt);
+  return entrada;
+}
+
+// marca os bits de acesso (e alteração, se 'alteracao') da página da
+//   entrada na tabela em uso, se ainda não estiverem marcados
+static void mmu__marca_acesso(mmu_t *self, tlb_entrada_t *entrada,
+                              bool alteracao)
+{
+  if (alteracao ? entrada->alterada : entrada->acessada) return;
+  tabpag_marca_bit_acesso(self->tabpag, entrada->pagina, alteracao);
+  entrada->acessada = true;
+  if (alteracao) entrada->alterada = true;
+}
+
+// ---------------------------------------------------------------------
+// acesso à memória
+
 err_t mmu_le(mmu_t *self, int endvirt, int *pvalor, cpu_modo_t modo)
 {
   if (modo == supervisor || self->tabpag == NULL) {
     return mem_le(self->mem, endvirt, pvalor);
   }
-  int endfis;
-  err_t err = tabpag_traduz(self->tabpag, endvirt, &endfis);
-  if (err == ERR_OK) {
-    err = mem_le(self->mem, endfis, pvalor);
-    if (err == ERR_OK) {
-      tabpag_marca_bit_acesso(self->tabpag, endvirt / TAM_PAGINA, false);
-    }
-  }
-  return err;
+  return mmu_le_paginado(self, endvirt, pvalor);
 }
 
 err_t mmu_escreve(mmu_t *self, int endvirt, int valor, cpu_modo_t modo)
@@ -51,13 +233,52 @@ err_t mmu_escreve(mmu_t *self, int endvirt, int valor, cpu_modo_t modo)
   if (modo == supervisor || self->tabpag == NULL) {
     return mem_escreve(self->mem, endvirt, valor);
   }
-  int endfis;
-  err_t err = tabpag_traduz(self->tabpag, endvirt, &endfis);
-  if (err == ERR_OK) {
-    err = mem_escreve(self->mem, endfis, valor);
-    if (err == ERR_OK) {
-      tabpag_marca_bit_acesso(self->tabpag, endvirt / TAM_PAGINA, true);
-    }
+  return mmu_escreve_paginado(self, endvirt, valor);
+}
+
+err_t mmu_traduz(mmu_t *self, int endvirt, int *pendfis, cpu_modo_t modo,
+                 int acesso)
+{
+  if (modo == supervisor || self->tabpag == NULL) {
+    // mesma verificação que mem_le faria
+    if (endvirt < 0 || endvirt >= mem_tam(self->mem)) return ERR_END_INV;
+    *pendfis = endvirt;
+    return ERR_OK;
   }
-  return err;
+  return mmu_traduz_paginado(self, endvirt, pendfis, acesso);
+}
+
+err_t mmu_le_paginado(mmu_t *self, int endvirt, int *pvalor)
+{
+  int endfis;
+  err_t err;
+  tlb_entrada_t *entrada = mmu__traduz(self, endvirt, &endfis, &err,
+                                       PAG_LEITURA);
+  if (entrada == NULL) return err;
+  *pvalor = self->palavras[endfis];
+  mmu__marca_acesso(self, entrada, false);
+  return ERR_OK;
+}
+
+err_t mmu_escreve_paginado(mmu_t *self, int endvirt, int valor)
+{
+  int endfis;
+  err_t err;
+  tlb_entrada_t *entrada = mmu__traduz(self, endvirt, &endfis, &err,
+                                       PAG_ESCRITA);
+  if (entrada == NULL) return err;
+  mem_escreve_valido(self->mem, endfis, valor);
+  mmu__marca_acesso(self, entrada, true);
+  return ERR_OK;
+}
+
+err_t mmu_traduz_paginado(mmu_t *self, int endvirt, int *pendfis, int acesso)
+{
+  int endfis;
+  err_t err;
+  tlb_entrada_t *entrada = mmu__traduz(self, endvirt, &endfis, &err, acesso);
+  if (entrada == NULL) return err;
+  mmu__marca_acesso(self, entrada, acesso == PAG_ESCRITA);
+  *pendfis = endfis;
+  return ERR_OK;
 }
@@ -10,6 +10,7 @@
 #include "memoria.h"
 #include "err.h"
 #include "cpu_modo.h"
+#include <stdio.h>
 
 // tipo opaco que representa a MMU
 typedef struct mmu_t mmu_t;
@@ -18,6 +19,9 @@ typedef struct mmu_t mmu_t;
 // retorna um ponteiro para um descritor, que deverá ser usado em todas
 //   as operações nessa MMU
 // recebe "mem", a memória física que será gerenciada
+// informa o tamanho da memória às tabelas de páginas (tabpag_define_memoria),
+//   que só vão aceitar quadros que estão nela; por isso, os endereços
+//   físicos traduzidos não são verificados novamente nos acessos
 // retorna NULL em caso de erro
 mmu_t *mmu_cria(mem_t *mem);
 
@@ -25,15 +29,29 @@ mmu_t *mmu_cria(mem_t *mem);
 // nenhuma outra operação pode ser realizada na MMU após esta chamada
 void mmu_destroi(mmu_t *self);
 
+// retorna a memória física gerenciada pela MMU
+mem_t *mmu_mem(mmu_t *self);
+
+// retorna a tabela de páginas em uso (pode ser NULL)
+tabpag_t *mmu_tabpag(mmu_t *self);
+
 // define a tabela de páginas a usar nas próximas traduções
 // se tabpag for NULL, os acessos serão repassados sem alteração à memória
+// as traduções guardadas na TLB de outras tabelas continuam valendo, e a
+//   MMU passa a observar as alterações na tabela (tabpag_define_obs_alteracao)
+//   para descartar as que deixarem de valer
 void mmu_define_tabpag(mmu_t *self, tabpag_t *tabpag);
 
+// imprime em 'arq' as estatísticas da TLB (acertos, faltas, substituições
+//   e entradas descartadas)
+void mmu_relatorio(mmu_t *self, FILE *arq);
+
 // coloca na posição apontada por 'pvalor' o valor que está na memória
 //   no endereço físico correspondente ao endereço virtual 'endvirt'
 // marca a página como acessada se o acesso for bem sucedido
 // retorna erro se acesso não for possível, por um erro de tradução
-//   (ver tabpag_traduz) ou de memória (ver mem_le)
+//   (ver tabpag_traduz), de proteção (ERR_PROT, se a página não permite
+//   leitura) ou de memória (ver mem_le)
 // se o acesso for feito em modo supervisor, ou se a mmu não tiver tabela de
 //   página definida, trata endvirt como enderço físico, repassa o acesso
 //   à memória sem tradução
@@ -43,10 +61,31 @@ err_t mmu_le(mmu_t *self, int endvirt, int *pvalor, cpu_modo_t modo);
 //   virtual 'endvirt'
 // marca a página como acessada e alterada se o acesso for bem sucedido
 // retorna erro se acesso não for possível, por um erro de tradução
-//   (ver tabpag_traduz) ou de memória (ver mem_escreve)
+//   (ver tabpag_traduz), de proteção (ERR_PROT, se a página não permite
+//   escrita) ou de memória (ver mem_escreve)
 // se o acesso for feito em modo supervisor, ou se a mmu não tiver tabela de
 //   página definida, trata endvirt como enderço físico, repassa o acesso
 //   à memória sem tradução
 err_t mmu_escreve(mmu_t *self, int endvirt, int valor, cpu_modo_t modo);
 
+// coloca na posição apontada por 'pendfis' o endereço físico correspondente
+//   ao endereço virtual 'endvirt', sem acessar a memória, para um acesso
+//   do tipo 'acesso' (PAG_LEITURA, PAG_ESCRITA ou PAG_EXECUCAO, esta
+//   usada pela CPU para buscar instruções)
+// a tradução e o tratamento de erros são os mesmos de mmu_le (ou
+//   mmu_escreve), inclusive a verificação do endereço físico e a marcação
+//   da página; um acesso do mesmo tipo no mesmo endereço logo em seguida
+//   seria bem sucedido
+// em modo supervisor ou sem tabela de páginas não há proteção
+err_t mmu_traduz(mmu_t *self, int endvirt, int *pendfis, cpu_modo_t modo,
+                 int acesso);
+
+// versões de mmu_le, mmu_escreve e mmu_traduz para acessos em modo usuário
+//   com tabela de páginas definida (sempre com tradução)
+// a CPU usa estas quando já sabe que está nessa situação, para não
+//   testar o modo e a tabela a cada acesso
+err_t mmu_le_paginado(mmu_t *self, int endvirt, int *pvalor);
+err_t mmu_escreve_paginado(mmu_t *self, int endvirt, int valor);
+err_t mmu_traduz_paginado(mmu_t *self, int endvirt, int *pendfis, int acesso);
+
 #endif // MMU_H
@@ -43,6 +43,20 @@ typedef struct processo_t
   dispositivo_bloqueado dispositivo_bloqueado;
 
   tabpag_t *tabpag;
+  // imagem do programa no SO (índice), compartilhada pelos processos que
+  //   executam o mesmo programa
+  int imagem;
+  // páginas ocupadas pelo programa; as páginas que o processo alterou e
+  //   que foram retiradas da memória principal estão na memória secundária
+  //   no quadro de cada uma em 'quadro_secundario' (a área do processo), e
+  //   estão marcadas em 'privada'; as outras são iguais às da imagem
+  int pagina_ini;
+  int pagina_fim;
+  int *quadro_secundario;
+  bool *privada;
+  // contadores de memória virtual do processo no SO (índice), que não
+  //   mudam de lugar; -1 se não tem
+  int estat;
 } processo_t;
 
 typedef struct tabela_processos_t
@@ -72,6 +86,12 @@ processo_t *cria_processo(int pid, char nome[100], int estado)
   novo_processo->estado_cpu.modo = 1; // usuário
   novo_processo->estado_cpu.erro = ERR_OK;
   novo_processo->tabpag = tabpag_cria();
+  novo_processo->imagem = -1;
+  novo_processo->pagina_ini = 0;
+  novo_processo->pagina_fim = -1;
+  novo_processo->quadro_secundario = NULL;
+  novo_processo->privada = NULL;
+  novo_processo->estat = -1;
   return novo_processo;
 }
 
@@ -96,6 +116,12 @@ processo_t *copia_processo(processo_t *processo)
   novo_processo->estado_cpu.erro = processo->estado_cpu.erro;
   novo_processo->dispositivo_bloqueado = processo->dispositivo_bloqueado;
   novo_processo->tabpag = processo->tabpag;
+  novo_processo->imagem = processo->imagem;
+  novo_processo->pagina_ini = processo->pagina_ini;
+  novo_processo->pagina_fim = processo->pagina_fim;
+  novo_processo->quadro_secundario = processo->quadro_secundario;
+  novo_processo->privada = processo->privada;
+  novo_processo->estat = processo->estat;
   return novo_processo;
 }
 
@@ -199,15 +225,16 @@ void destroi_processo(processo_t *processo)
     return;
   }
 
-  // Tem que liberar a memória aqui, mas da segfault com o código
-  // abaixo.
-
-  // if (processo->tabpag != NULL)
-  // {
-  //   tabpag_destroi(processo->tabpag);
-  // }
-
-  // free(processo);
+  // o descritor está no vetor da tabela de processos, não é liberado aqui
+  if (processo->tabpag != NULL)
+  {
+    tabpag_destroi(processo->tabpag);
+    processo->tabpag = NULL;
+  }
+  free(processo->quadro_secundario);
+  processo->quadro_secundario = NULL;
+  free(processo->privada);
+  processo->privada = NULL;
 }
 
 bool remove_processo_tabela(tabela_processos_t *tabela, int targetPID)
@@ -221,7 +248,8 @@ bool remove_processo_tabela(tabela_processos_t *tabela, int targetPID)
         tabela->processos[j] = tabela->processos[j + 1];
       }
       tabela->quantidade_processos--;
-      destroi_processo(&(tabela->processos[i]));
+      // não destrói o processo: a remoção também é usada para mudar ele
+      //   de lugar na tabela
       return true;
     }
   }
@@ -38,6 +38,20 @@ typedef struct processo_t
   dispositivo_bloqueado dispositivo_bloqueado;
 
   tabpag_t *tabpag;
+  // imagem do programa no SO (índice), compartilhada pelos processos que
+  //   executam o mesmo programa
+  int imagem;
+  // páginas ocupadas pelo programa; as páginas que o processo alterou e
+  //   que foram retiradas da memória principal estão na memória secundária
+  //   no quadro de cada uma em 'quadro_secundario' (a área do processo), e
+  //   estão marcadas em 'privada'; as outras são iguais às da imagem
+  int pagina_ini;
+  int pagina_fim;
+  int *quadro_secundario;
+  bool *privada;
+  // contadores de memória virtual do processo no SO (índice), que não
+  //   mudam de lugar; -1 se não tem
+  int estat;
 } processo_t;
 
 typedef struct tabela_processos_t
@@ -54,6 +68,10 @@ processo_t *cria_processo(int pid, char nome[100], int estado);
 processo_t *copia_processo(processo_t *processo);
 processo_t *pega_proximo_processo_disponivel(tabela_processos_t *tabela);
 bool remove_processo_tabela(tabela_processos_t *tabela, int targetPID);
+// libera os recursos do processo (a tabela de páginas e os vetores
+//   'quadro_secundario' e 'privada'); os quadros da área do processo na
+//   memória secundária são devolvidos antes pelo SO
+void destroi_processo(processo_t *processo);
 int quantum();
 
 #endif // PROCESSO_H
\ No newline at end of file
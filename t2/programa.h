@@ -26,4 +26,8 @@ int prog_end_inicio(programa_t *self);
 // valor a colocar na posição 'ender' da memória
 int prog_dado(programa_t *self, int ender);
 
+// vetor com os prog_tamanho() valores a colocar na memória a partir do
+//   endereço de carga
+const int *prog_dados(programa_t *self);
+
 #endif // PROGRAMA_H
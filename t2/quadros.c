@@ -0,0 +1,209 @@
+#include "quadros.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define BITS_PALAVRA 64
+
+// uma página mapeada em um quadro
+typedef struct {
+  tabpag_t *tabpag;
+  int pagina;
+  int dono;
+} mapeamento_t;
+
+// as páginas mapeadas em um quadro; em geral só uma, mais de uma se ele
+//   for compartilhado
+typedef struct {
+  mapeamento_t *v;
+  int n;
+  int cap;
+} mapeamentos_t;
+
+struct quadros_t {
+  int primeiro;
+  int n_quadros;
+  uint64_t *livres;  // mapa de bits, 1 se o quadro está livre
+  int *pilha;        // quadros livres; o do topo é o próximo a alocar
+  int n_livres;      // tamanho da pilha
+  mapeamentos_t *mapeamentos;  // mapa reverso, um por quadro
+};
+
+static bool quadros__bit(quadros_t *self, int quadro)
+{
+  return (self->livres[quadro / BITS_PALAVRA] >> (quadro % BITS_PALAVRA)) & 1;
+}
+
+static void quadros__muda_bit(quadros_t *self, int quadro, bool livre)
+{
+  uint64_t mascara = (uint64_t)1 << (quadro % BITS_PALAVRA);
+  if (livre) {
+    self->livres[quadro / BITS_PALAVRA] |= mascara;
+  } else {
+    self->livres[quadro / BITS_PALAVRA] &= ~mascara;
+  }
+}
+
+quadros_t *quadros_cria(int primeiro, int n_quadros)
+{
+  if (primeiro < 0) primeiro = 0;
+  if (n_quadros < primeiro) n_quadros = primeiro;
+  quadros_t *self = malloc(sizeof(*self));
+  if (self == NULL) return NULL;
+  int n_palavras = (n_quadros + BITS_PALAVRA - 1) / BITS_PALAVRA;
+  self->livres = calloc(n_palavras > 0 ? n_palavras : 1, sizeof(uint64_t));
+  self->pilha = malloc((n_quadros > 0 ? n_quadros : 1) * sizeof(int));
+  self->mapeamentos = calloc(n_quadros > 0 ? n_quadros : 1,
+                             sizeof(mapeamentos_t));
+  if (self->livres == NULL || self->pilha == NULL
+      || self->mapeamentos == NULL) {
+    free(self->livres);
+    free(self->pilha);
+    free(self->mapeamentos);
+    free(self);
+    return NULL;
+  }
+  self->primeiro = primeiro;
+  self->n_quadros = n_quadros;
+  // empilha do último para o primeiro, para alocar em ordem crescente
+  self->n_livres = 0;
+  for (int q = n_quadros - 1; q >= primeiro; q--) {
+    self->pilha[self->n_livres++] = q;
+    quadros__muda_bit(self, q, true);
+  }
+  return self;
+}
+
+void quadros_destroi(quadros_t *self)
+{
+  for (int q = 0; q < self->n_quadros; q++) {
+    free(self->mapeamentos[q].v);
+  }
+  free(self->mapeamentos);
+  free(self->livres);
+  free(self->pilha);
+  free(self);
+}
+
+int quadros_aloca(quadros_t *self)
+{
+  if (self->n_livres == 0) return -1;
+  int quadro = self->pilha[--self->n_livres];
+  quadros__muda_bit(self, quadro, false);
+  return quadro;
+}
+
+void quadros_libera(quadros_t *self, int quadro)
+{
+  if (quadro < self->primeiro || quadro >= self->n_quadros) return;
+  if (quadros__bit(self, quadro)) return;
+  quadros__muda_bit(self, quadro, true);
+  self->pilha[self->n_livres++] = quadro;
+}
+
+bool quadros_livre(quadros_t *self, int quadro)
+{
+  if (quadro < self->primeiro || quadro >= self->n_quadros) return false;
+  return quadros__bit(self, quadro);
+}
+
+int quadros_n_livres(quadros_t *self)
+{
+  return self->n_livres;
+}
+
+int quadros_n_alocaveis(quadros_t *self)
+{
+  return self->n_quadros - self->primeiro;
+}
+
+int quadros_fragmentacao(quadros_t *self)
+{
+  if (self->n_livres == 0) return 0;
+  int maior = 0;
+  int atual = 0;
+  for (int q = self->primeiro; q < self->n_quadros; q++) {
+    if (quadros__bit(self, q)) {
+      atual++;
+      if (atual > maior) maior = atual;
+    } else {
+      atual = 0;
+    }
+  }
+  return 100 - 100 * maior / self->n_livres;
+}
+
+// ---------------------------------------------------------------------
+// mapa reverso
+
+// tira do registro o mapeamento da página, se ela estiver mapeada
+// retorna false se não estiver
+static bool quadros__esquece(quadros_t *self, tabpag_t *tabpag, int pagina)
+{
+  int endfis;
+  if (tabpag_traduz(tabpag, END_DA_PAGINA(pagina), &endfis) != ERR_OK) {
+    return false;
+  }
+  int quadro = PAGINA_DO_END(endfis);
+  mapeamentos_t *m = &self->mapeamentos[quadro];
+  for (int i = 0; i < m->n; i++) {
+    if (m->v[i].tabpag == tabpag && m->v[i].pagina == pagina) {
+      // a ordem não importa; o último ocupa o lugar do removido
+      m->v[i] = m->v[--m->n];
+      break;
+    }
+  }
+  return true;
+}
+
+err_t quadros_mapeia(quadros_t *self, int quadro, tabpag_t *tabpag,
+                     int pagina, int dono)
+{
+  if (quadro < 0 || quadro >= self->n_quadros) return ERR_END_INV;
+  mapeamentos_t *m = &self->mapeamentos[quadro];
+  if (m->n == m->cap) {
+    int cap = m->cap == 0 ? 1 : 2 * m->cap;
+    mapeamento_t *v = realloc(m->v, cap * sizeof(mapeamento_t));
+    if (v == NULL) return ERR_END_INV;
+    m->v = v;
+    m->cap = cap;
+  }
+  quadros__esquece(self, tabpag, pagina);
+  err_t err = tabpag_define_quadro(tabpag, pagina, quadro);
+  if (err != ERR_OK) return err;
+  // com a tabela invertida, o quadro deixou de estar em outra página
+  if (!tabpag_quadro_compartilhavel()) m->n = 0;
+  m->v[m->n++] = (mapeamento_t){ tabpag, pagina, dono };
+  return ERR_OK;
+}
+
+void quadros_desmapeia(quadros_t *self, tabpag_t *tabpag, int pagina)
+{
+  if (quadros__esquece(self, tabpag, pagina)) {
+    tabpag_define_quadro(tabpag, pagina, -1);
+  }
+}
+
+void quadros_desmapeia_todos(quadros_t *self, int quadro)
+{
+  if (quadro < 0 || quadro >= self->n_quadros) return;
+  mapeamentos_t *m = &self->mapeamentos[quadro];
+  while (m->n > 0) {
+    m->n--;
+    tabpag_define_quadro(m->v[m->n].tabpag, m->v[m->n].pagina, -1);
+  }
+}
+
+int quadros_n_mapeamentos(quadros_t *self, int quadro)
+{
+  if (quadro < 0 || quadro >= self->n_quadros) return 0;
+  return self->mapeamentos[quadro].n;
+}
+
+void quadros_mapeamento(quadros_t *self, int quadro, int i,
+                        tabpag_t **ptabpag, int *ppagina, int *pdono)
+{
+  mapeamento_t *mp = &self->mapeamentos[quadro].v[i];
+  *ptabpag = mp->tabpag;
+  *ppagina = mp->pagina;
+  *pdono = mp->dono;
+}
@@ -0,0 +1,81 @@
+#ifndef QUADROS_H
+#define QUADROS_H
+
+// alocador de quadros de uma memória
+// estrutura auxiliar do SO, que controla quais quadros estão livres com um
+//   mapa de bits (um bit por quadro) e uma pilha com os quadros livres, para
+//   alocar e liberar um quadro em tempo constante; o SO usa um para a
+//   memória principal e outro para a secundária
+// para a memória principal, mantém também o mapa reverso: para cada
+//   quadro, as páginas (de quaisquer tabelas) que estão mapeadas nele, e o
+//   dono de cada uma; o SO altera os mapeamentos através dele, para que
+//   estejam sempre registrados, e acha quem usa um quadro sem percorrer as
+//   tabelas de todos os processos
+
+#include "err.h"
+#include "tabpag.h"
+#include <stdbool.h>
+
+// tipo opaco que representa o alocador
+typedef struct quadros_t quadros_t;
+
+// cria o alocador para uma memória de 'n_quadros' quadros, em que os
+//   quadros a partir de 'primeiro' estão livres (os anteriores nunca são
+//   alocados)
+// os quadros são alocados inicialmente em ordem crescente
+// retorna NULL em caso de erro
+quadros_t *quadros_cria(int primeiro, int n_quadros);
+
+// destrói o alocador
+void quadros_destroi(quadros_t *self);
+
+// retorna um quadro livre, que passa a estar ocupado, ou -1 se não houver
+int quadros_aloca(quadros_t *self);
+
+// libera o quadro, que vai ser o próximo alocado
+// não faz nada se o quadro já estiver livre ou não puder ser alocado
+void quadros_libera(quadros_t *self, int quadro);
+
+// retorna true se o quadro está livre
+bool quadros_livre(quadros_t *self, int quadro);
+
+// retorna o número de quadros livres
+int quadros_n_livres(quadros_t *self);
+
+// retorna o número de quadros que podem ser alocados (livres ou não)
+int quadros_n_alocaveis(quadros_t *self);
+
+// retorna a fragmentação dos quadros livres, em porcentagem: 0 se eles
+//   formam uma só sequência contígua (ou não há quadro livre), e perto de
+//   100 se estão todos separados
+// calculada como 100 * (1 - maior sequência contígua / quadros livres),
+//   percorrendo o mapa de bits
+int quadros_fragmentacao(quadros_t *self);
+
+// mapa reverso
+
+// mapeia a página 'pagina' da tabela 'tabpag' no quadro, com
+//   tabpag_define_quadro, e registra o mapeamento, com o dono 'dono' (um
+//   número escolhido pelo SO para identificar o processo)
+// se a página estava mapeada em outro quadro, o mapeamento anterior é
+//   desfeito
+// retorna o erro de tabpag_define_quadro (e não registra nada)
+err_t quadros_mapeia(quadros_t *self, int quadro, tabpag_t *tabpag,
+                     int pagina, int dono);
+
+// desfaz o mapeamento da página 'pagina' da tabela 'tabpag', se houver
+void quadros_desmapeia(quadros_t *self, tabpag_t *tabpag, int pagina);
+
+// desfaz todos os mapeamentos do quadro, em tempo proporcional ao número
+//   deles
+void quadros_desmapeia_todos(quadros_t *self, int quadro);
+
+// retorna o número de páginas mapeadas no quadro
+int quadros_n_mapeamentos(quadros_t *self, int quadro);
+
+// coloca em '*ptabpag', '*ppagina' e '*pdono' o mapeamento 'i' (de 0 ao
+//   número de mapeamentos - 1) do quadro
+void quadros_mapeamento(quadros_t *self, int quadro, int i,
+                        tabpag_t **ptabpag, int *ppagina, int *pdono);
+
+#endif // QUADROS_H
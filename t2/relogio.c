@@ -37,6 +37,19 @@ void rel_tictac(relogio_t *self)
   }
 }
 
+void rel_avanca(relogio_t *self, int n)
+{
+  self->agora += n;
+  if (self->t_ate_interrupcao != 0) {
+    if (n >= self->t_ate_interrupcao) {
+      self->t_ate_interrupcao = 0;
+      self->interrupcao = 1;
+    } else {
+      self->t_ate_interrupcao -= n;
+    }
+  }
+}
+
 int rel_agora(relogio_t *self)
 {
   return self->agora;
@@ -20,6 +20,11 @@ void rel_destroi(relogio_t *self);
 // esta função é chamada pelo controlador após a execução de cada instrução
 void rel_tictac(relogio_t *self);
 
+// registra a passagem de 'n' unidades de tempo, com o mesmo efeito de
+//   'n' chamadas a rel_tictac
+// usada pelo controlador quando executa várias instruções de uma vez
+void rel_avanca(relogio_t *self, int n);
+
 // retorna a hora atual do sistema, em unidades de tempo
 int rel_agora(relogio_t *self);
 
@@ -4,6 +4,8 @@
 #include "processo.h"
 #include "instrucao.h"
 #include "tabpag.h"
+#include "substituicao.h"
+#include "quadros.h"
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -13,18 +15,120 @@
 // intervalo entre interrupções do relógio
 #define INTERVALO_INTERRUPCAO 50 // em instruções executadas
 
+// janela inicial e máxima da leitura antecipada, em páginas
+#define ANTECIPA_JANELA_INI 1
+#define ANTECIPA_JANELA_MAX 8
+
+// exames seguidos do limpador sem acesso à página para que ela seja gravada
+#define LIMPEZA_OCIOSIDADE 4
+
 int id_processo_executando = -1;
 
-// Não tem processos nem memória virtual, mas é preciso usar a paginação,
-//   pelo menos para implementar relocação, já que os programas estão sendo
-//   todos montados para serem executados no endereço 0 e o endereço 0
-//   físico é usado pelo hardware nas interrupções.
-// Os programas vão ser carregados no início de um quadro, e usar quantos
-//   quadros forem necessárias. Para isso a variável quadro_livre vai conter
-//   o número do primeiro quadro da memória principal que ainda não foi usado.
-//   Na carga do processo, a tabela de páginas (deveria ter uma por processo,
-//   mas não tem processo) é alterada para que o endereço virtual 0 resulte
-//   no quadro onde o programa foi carregado.
+// Memória virtual com paginação por demanda.
+// Na primeira carga de um programa, ele é copiado para quadros da memória
+//   secundária, um para cada página, formando a imagem do programa; as
+//   cargas seguintes do mesmo programa usam a mesma imagem, sem ler o
+//   arquivo de novo. Todas as páginas do processo ficam ausentes na tabela
+//   de páginas dele. O acesso a uma página ausente causa um erro
+//   ERR_PAG_AUSENTE na CPU; o SO coloca a página em um quadro da memória
+//   principal, mapeia ela, e o processo reexecuta a instrução que causou a
+//   falta. Assim, só as páginas usadas ocupam memória principal, e os
+//   programas juntos podem ser maiores que ela.
+// Uma página da imagem que está na memória principal é compartilhada: o
+//   mesmo quadro é mapeado, só para leitura e execução, em todos os
+//   processos que executam o programa. A primeira escrita de um processo
+//   nela causa ERR_PROT; o SO copia a página para um quadro só do processo,
+//   que pode ser alterado, e a instrução é reexecutada (cópia na escrita).
+//   Assim, cada processo a mais executando um programa só ocupa memória com
+//   as páginas que ele altera. Na carga, cada processo recebe uma área da
+//   memória secundária, um quadro para cada página do programa, para onde
+//   vão as páginas que ele alterou quando saem da memória principal.
+// Com a tabela invertida (TABPAG_INVERTIDA), um quadro só pode estar em uma
+//   tabela, e cada processo recebe sua própria cópia das páginas da imagem.
+// Os quadros livres da memória principal são controlados pelo alocador de
+//   quadros (quadros.h), e os quadros de um processo voltam para ele quando
+//   o processo termina. O alocador mantém também o mapa reverso, com as
+//   páginas mapeadas em cada quadro: todo mapeamento feito pelo SO passa
+//   por ele, e assim as páginas de um quadro que vai ser liberado são
+//   achadas sem percorrer as tabelas de todos os processos. Quando não tem
+//   quadro livre, a política de substituição (substituicao.h) escolhe um
+//   quadro ocupado, e a página que está nele volta para a memória
+//   secundária (só é copiada se foi alterada). Os quadros da memória
+//   secundária têm outro alocador (sem uso do mapa reverso): a área de um
+//   processo volta para ele quando o processo termina, e os quadros de uma
+//   imagem ficam com ela enquanto ela existir.
+// Para que a falta de página não tenha que esperar a gravação de uma página
+//   alterada, o limpador de páginas executa a cada interrupção do relógio:
+//   grava as cópias privadas alteradas que não estão sendo usadas, e
+//   libera quadros (gravando antes os alterados) até ter uma reserva de
+//   quadros livres. Com isso, a falta em geral só lê a página. Como um
+//   ponteiro de relógio, o limpador zera os bits de acesso dos quadros que
+//   examina, e uma página só é gravada depois de LIMPEZA_OCIOSIDADE exames
+//   seguidos sem acesso; o acesso que ele zera fica guardado para a
+//   política de substituição, e o que a política zera fica guardado para
+//   ele, para que um não esconda do outro o uso das páginas.
+// Leitura antecipada: quando um processo tem uma falta na página seguinte à
+//   da falta anterior (ou à última lida antecipadamente), o acesso parece
+//   sequencial, e o SO coloca também as próximas páginas do programa na
+//   memória, em quadros livres. O número de páginas antecipadas (a janela)
+//   dobra quando uma delas é usada, e cai à metade quando uma sai da
+//   memória sem ter sido usada.
+
+// contadores de memória virtual de um processo, e o estado da leitura
+//   antecipada dele
+typedef struct
+{
+  char nome[100];
+  int pid;
+  int faltas;        // faltas de página
+  int copias;        // páginas compartilhadas copiadas na escrita
+  int substituidas;  // páginas do processo retiradas da memória principal
+  int gravadas;      // dessas, as alteradas, gravadas na memória secundária
+  int limpas;        // páginas gravadas pelo limpador, antes de sair
+  int antecipadas;   // páginas lidas antecipadamente
+  int acertos;       // dessas, as que foram usadas
+  int desperdicios;  // e as que saíram da memória sem uso
+  int ultima_falta;  // última página da última falta (ou antecipada)
+  int janela;        // páginas a antecipar em uma falta sequencial
+  int antecipada_ini;  // páginas lidas na última antecipação
+  int antecipada_fim;
+} so_estat_t;
+
+// imagem de um programa carregado, na memória secundária
+typedef struct
+{
+  char nome[100];
+  int end_ini;            // endereços virtuais ocupados pelo programa
+  int end_fim;
+  int pagina_ini;
+  int pagina_fim;
+  int *quadro_secundario; // quadro da memória secundária com cada página
+  int *quadro;            // quadro compartilhado com cada página, ou -1
+  trad_programa_t *trad;  // tradução para C, se houver
+} so_imagem_t;
+
+// o que está em um quadro ocupado da memória principal
+typedef struct
+{
+  int imagem;          // imagem do programa dos processos que usam o quadro,
+                       //   -1 se o quadro está livre
+  int pagina;
+  bool compartilhado;  // página da imagem, mapeada só para leitura; senão,
+                       //   é a cópia de um só processo
+  // para uma cópia privada, onde ela é gravada na memória secundária, e a
+  //   marca do processo de que a página está lá
+  int quadro_secundario;
+  bool *privada;
+  // dono (ver so_dono_do_processo) que leu a página antecipadamente, enquanto
+  //   ela não foi usada; -1 se não foi antecipada ou já foi usada
+  int antecipada_por;
+  // acessos cujo bit foi zerado e que ainda não foram vistos: pela política
+  //   de substituição (o limpador zerou) e pelo limpador (a política zerou)
+  bool acesso_politica;
+  bool acesso_limpador;
+  // exames seguidos do limpador em que a página não tinha sido acessada
+  int ociosidade;
+} so_quadro_t;
 
 struct so_t
 {
@@ -35,9 +139,23 @@ struct so_t
   console_t *console;
   relogio_t *relogio;
   tabela_processos_t *tabela_processos;
-  // quando tiver memória virtual, o controle de memória livre e ocupada
-  //   é mais completo que isso
-  int quadro_livre;
+  // o controle de memória livre e ocupada deveria ser mais completo que isso
+  quadros_t *quadros;
+  quadros_t *quadros_secundarios;
+  int n_quadros;
+  so_quadro_t *conteudo_quadro;
+  subst_t *subst;
+  // limpador de páginas
+  int orcamento_limpeza;
+  int reserva_livres;
+  int ponteiro_limpeza;  // próximo quadro que o limpador examina
+  int liberados_limpeza; // quadros liberados pelo limpador
+  // imagens dos programas já carregados, que não são descartadas
+  so_imagem_t *imagens;
+  int n_imagens;
+  // contadores de cada processo criado, na ordem de criação
+  so_estat_t *estat;
+  int n_estat;
   // quando tiver processos, não tem essa tabela aqui, tem que tem uma para
   //   cada processo
   tabpag_t *tabpag;
@@ -48,11 +166,24 @@ static err_t so_trata_interrupcao(void *argC, int reg_A);
 
 // funções auxiliares
 static int so_carrega_programa(so_t *self, char *nome_do_executavel, processo_t *processo);
+static bool so_carrega_pagina(so_t *self, processo_t *processo, int pagina);
+static bool so_copia_na_escrita(so_t *self, processo_t *processo, int pagina);
+static int so_aloca_quadro(so_t *self);
+static void so_retira_pagina(so_t *self, int quadro);
+static void so_libera_memoria(so_t *self, processo_t *processo);
+static void so_limpa_paginas(so_t *self);
+static so_estat_t *so_estat_do_processo(so_t *self, processo_t *processo);
+static bool so_quadro_acessado(void *arg, int quadro);
+static bool so_quadro_alterado(void *arg, int quadro);
+static void so_quadro_zera_acesso(void *arg, int quadro);
+static bool so_zera_bits_acesso(so_t *self, int quadro);
+static void so_imprime_estat(so_t *self, so_estat_t *estat);
 static bool so_copia_str_do_processo(so_t *self, int tam, char str[tam],
                                      int end_virt, processo_t *processo);
 
 so_t *so_cria(cpu_t *cpu, mem_t *mem, mem_t *mem_secundaria, mmu_t *mmu,
-              console_t *console, relogio_t *relogio)
+              console_t *console, relogio_t *relogio,
+              subst_politica_t politica)
 {
   so_t *self = malloc(sizeof(*self));
   if (self == NULL)
@@ -69,15 +200,25 @@ so_t *so_cria(cpu_t *cpu, mem_t *mem, mem_t *mem_secundaria, mmu_t *mmu,
   // quando a CPU executar uma instrução CHAMAC, deve chamar a função
   //   so_trata_interrupcao
   cpu_define_chamaC(self->cpu, so_trata_interrupcao, self);
+#if defined(SO_INTERRUPCAO_MEMORIA)
+  // o estado da CPU interrompida fica no início da memória (IRQ_END_*)
+  cpu_define_estado_em_memoria(self->cpu, true);
+#elif defined(SO_INTERRUPCAO_DIRETA)
+  // a interrupção chama so_trata_interrupcao sem passar pelo endereço 10
+  cpu_define_interrupcao_direta(self->cpu, true);
+#endif
 
   // coloca o tratador de interrupção na memória
   // quando a CPU aceita uma interrupção, passa para modo supervisor,
-  //   salva seu estado à partir do endereço 0, e desvia para o endereço 10
+  //   salva seu estado (acessível com cpu_pega_estado), e desvia para o
+  //   endereço 10
   // colocamos no endereço 10 a instrução CHAMAC, que vai chamar
   //   so_trata_interrupcao (conforme foi definido acima) e no endereço 11
   //   colocamos a instrução RETI, para que a CPU retorne da interrupção
-  //   (recuperando seu estado no endereço 0) depois que o SO retornar de
+  //   (recuperando o estado salvo) depois que o SO retornar de
   //   so_trata_interrupcao.
+  // a interrupção de reset é atendida por esse código mesmo com
+  //   interrupção direta, porque a CPU começa a executar no endereço 0
   mem_escreve(self->mem, 10, CHAMAC);
   mem_escreve(self->mem, 11, RETI);
 
@@ -88,16 +229,48 @@ so_t *so_cria(cpu_t *cpu, mem_t *mem, mem_t *mem_secundaria, mmu_t *mmu,
   // com processos, essa tabela não existiria, teria uma por processo
   self->tabpag = tabpag_cria();
   mmu_define_tabpag(self->mmu, self->tabpag);
-  // define o primeiro quadro livre de memória como o seguinte àquele que
-  //   contém o endereço 99 (as 100 primeiras posições de memória (pelo menos)
-  //   não vão ser usadas por programas de usuário)
-  self->quadro_livre = 99 / TAM_PAGINA + 1;
+  // só os quadros inteiros podem ser usados
+  self->n_quadros = PAGINA_DO_END(mem_tam(self->mem));
+  // o primeiro quadro livre de memória é o seguinte àquele que contém o
+  //   endereço 99 (as 100 primeiras posições de memória (pelo menos) não
+  //   vão ser usadas por programas de usuário)
+  self->quadros = quadros_cria(PAGINA_DO_END(99) + 1, self->n_quadros);
+  // a memória secundária só é usada pelo SO, toda ela pode ser alocada
+  self->quadros_secundarios =
+      quadros_cria(0, PAGINA_DO_END(mem_tam(self->mem_secundaria)));
+  self->conteudo_quadro = malloc(self->n_quadros * sizeof(so_quadro_t));
+  for (int quadro = 0; quadro < self->n_quadros; quadro++)
+  {
+    self->conteudo_quadro[quadro].imagem = -1;
+  }
+  subst_bits_t bits = {so_quadro_acessado, so_quadro_alterado,
+                       so_quadro_zera_acesso};
+  self->subst = subst_cria(politica, self->n_quadros, bits, self);
+  self->orcamento_limpeza = SO_LIMPEZA_ORCAMENTO;
+  self->reserva_livres = SO_LIMPEZA_RESERVA;
+  self->ponteiro_limpeza = 0;
+  self->liberados_limpeza = 0;
+  self->imagens = NULL;
+  self->n_imagens = 0;
+  self->estat = NULL;
+  self->n_estat = 0;
   return self;
 }
 
 void so_destroi(so_t *self)
 {
   cpu_define_chamaC(self->cpu, NULL, NULL);
+  subst_destroi(self->subst);
+  quadros_destroi(self->quadros);
+  quadros_destroi(self->quadros_secundarios);
+  free(self->conteudo_quadro);
+  for (int i = 0; i < self->n_imagens; i++)
+  {
+    free(self->imagens[i].quadro_secundario);
+    free(self->imagens[i].quadro);
+  }
+  free(self->imagens);
+  free(self->estat);
   free(self);
 }
 
@@ -152,6 +325,14 @@ static err_t so_trata_interrupcao(void *argC, int reg_A)
   so_escalona(self);
   // recupera o estado do processo escolhido
   so_carrega_estado_processo_na_cpu(self);
+  // sem nenhum processo, não tem mais o que executar: a CPU para aqui, em
+  //   modo supervisor, sem voltar ao modo usuário sem tabela de páginas
+  // se ainda há processos, mas todos bloqueados, a CPU volta parada (ver
+  //   so_carrega_estado_processo_na_cpu) até a próxima interrupção
+  if (self->tabela_processos->quantidade_processos == 0)
+  {
+    return ERR_CPU_PARADA;
+  }
   return err;
 }
 
@@ -161,13 +342,22 @@ void so_salva_estado_cpu_no_processo(so_t *self)
   if (processo_atual == NULL)
     return;
   console_printf(self->console, "SO: Salva estado da cpu no processo %s", processo_atual->nome);
-  mem_le(self->mem, IRQ_END_X, &processo_atual->estado_cpu.registradorX);
-  mem_le(self->mem, IRQ_END_A, &processo_atual->estado_cpu.registradorA);
-  mem_le(self->mem, IRQ_END_PC, &processo_atual->estado_cpu.registradorPC);
-  mem_le(self->mem, IRQ_END_complemento, &processo_atual->estado_cpu.complemento);
-  int leitura_memoria;
-  mem_le(self->mem, IRQ_END_erro, &leitura_memoria);
-  processo_atual->estado_cpu.erro = leitura_memoria;
+  cpu_estado_t estado;
+  cpu_pega_estado(self->cpu, &estado);
+  processo_atual->estado_cpu.registradorX = estado.X;
+  processo_atual->estado_cpu.registradorA = estado.A;
+  processo_atual->estado_cpu.registradorPC = estado.PC;
+  processo_atual->estado_cpu.complemento = estado.complemento;
+  processo_atual->estado_cpu.erro = estado.erro;
+}
+
+// altera o registrador de erro no estado a recuperar no retorno da interrupção
+static void so_define_erro_cpu(so_t *self, err_t erro)
+{
+  cpu_estado_t estado;
+  cpu_pega_estado(self->cpu, &estado);
+  estado.erro = erro;
+  cpu_define_estado(self->cpu, &estado);
 }
 
 void so_carrega_estado_processo_na_cpu(so_t *self)
@@ -175,16 +365,19 @@ void so_carrega_estado_processo_na_cpu(so_t *self)
   processo_t *processo_atual = encontrar_processo_por_pid(self->tabela_processos, id_processo_executando);
   if (processo_atual == NULL)
   {
-    mem_escreve(self->mem, IRQ_END_erro, ERR_CPU_PARADA);
+    so_define_erro_cpu(self, ERR_CPU_PARADA);
     return;
   }
   console_printf(self->console, "SO: Carrega estado do processo %s na cpu", processo_atual->nome);
-  mem_escreve(self->mem, IRQ_END_X, processo_atual->estado_cpu.registradorX);
-  mem_escreve(self->mem, IRQ_END_A, processo_atual->estado_cpu.registradorA);
-  mem_escreve(self->mem, IRQ_END_PC, processo_atual->estado_cpu.registradorPC);
-  mem_escreve(self->mem, IRQ_END_erro, processo_atual->estado_cpu.erro);
-  mem_escreve(self->mem, IRQ_END_complemento, processo_atual->estado_cpu.complemento);
-  mem_escreve(self->mem, IRQ_END_modo, processo_atual->estado_cpu.modo);
+  cpu_estado_t estado = {
+    .PC = processo_atual->estado_cpu.registradorPC,
+    .A = processo_atual->estado_cpu.registradorA,
+    .X = processo_atual->estado_cpu.registradorX,
+    .erro = processo_atual->estado_cpu.erro,
+    .complemento = processo_atual->estado_cpu.complemento,
+    .modo = processo_atual->estado_cpu.modo,
+  };
+  cpu_define_estado(self->cpu, &estado);
 }
 
 bool pode_desbloquear(so_t *self, processo_t *processo)
@@ -261,7 +454,7 @@ static void so_escalona(so_t *self)
     processo_t *proximo_processo = pega_proximo_processo_disponivel(self->tabela_processos);
     if (proximo_processo == NULL)
     {
-      mem_escreve(self->mem, IRQ_END_erro, ERR_CPU_PARADA);
+      so_define_erro_cpu(self, ERR_CPU_PARADA);
       return;
     }
     id_processo_executando = proximo_processo->pid;
@@ -292,7 +485,7 @@ static void so_escalona(so_t *self)
       if (proximo_processo == NULL)
       {
         id_processo_executando = -1;
-        mem_escreve(self->mem, IRQ_END_erro, ERR_CPU_PARADA);
+        so_define_erro_cpu(self, ERR_CPU_PARADA);
         return;
       }
       id_processo_executando = proximo_processo->pid;
@@ -348,14 +541,17 @@ static err_t so_trata_irq_reset(so_t *self)
   processo_adicionado->estado_cpu.registradorPC = ender;
   processo_adicionado->estado_cpu.modo = usuario;
 
-  mem_escreve(self->mem, IRQ_END_modo, usuario);
+  cpu_estado_t estado;
+  cpu_pega_estado(self->cpu, &estado);
+  estado.modo = usuario;
+  cpu_define_estado(self->cpu, &estado);
   return ERR_OK;
 }
 
 static err_t so_trata_irq_err_cpu(so_t *self)
 {
   // Ocorreu um erro interno na CPU
-  // O erro está codificado em IRQ_END_erro
+  // O erro está no estado salvo da CPU
   // Em geral, causa a morte do processo que causou o erro
   // Ainda não temos processos, causa a parada da CPU
   int err_int;
@@ -369,6 +565,18 @@ static err_t so_trata_irq_err_cpu(so_t *self)
   {
     err_int = processo_atual->estado_cpu.erro;
     err_t err = err_int;
+    int pagina = PAGINA_DO_END(processo_atual->estado_cpu.complemento);
+    if ((err == ERR_PAG_AUSENTE
+         && so_carrega_pagina(self, processo_atual, pagina))
+        || (err == ERR_PROT
+            && so_copia_na_escrita(self, processo_atual, pagina)))
+    {
+      // a instrução que causou a falta não executou, e vai ser executada
+      //   de novo no retorno da interrupção, agora com a página na memória
+      //   (ou, se era escrita em página compartilhada, com a cópia dela)
+      processo_atual->estado_cpu.erro = ERR_OK;
+      return ERR_OK;
+    }
     if (err != ERR_OK)
     {
       console_printf(self->console, "SO: IRQ tratada, erro na execução, eliminando processo: %s", processo_atual->nome);
@@ -378,7 +586,9 @@ static err_t so_trata_irq_err_cpu(so_t *self)
     return ERR_OK;
   }
 
-  mem_le(self->mem, IRQ_END_erro, &err_int);
+  cpu_estado_t estado;
+  cpu_pega_estado(self->cpu, &estado);
+  err_int = estado.erro;
   err_t err = err_int;
 
   console_printf(self->console,
@@ -405,6 +615,11 @@ static err_t so_trata_irq_relogio(so_t *self)
       processo_atual->quantum = quantum();
     }
   }
+  // o limpador e as políticas de substituição que acompanham o uso das
+  //   páginas zeram os bits de acesso, mas cada um guarda para o outro os
+  //   acessos que zerou (ver so_quadro_t)
+  so_limpa_paginas(self);
+  subst_tictac(self->subst);
   console_printf(self->console, "SO: interrupcao do relogio");
   return ERR_OK;
 }
@@ -523,6 +738,28 @@ processo_t *so_cria_processo(so_t *self, char nome[100])
   adiciona_novo_processo_na_tabela(self->tabela_processos, nome);
   processo_t *processo_carregado = &self->tabela_processos->processos[self->tabela_processos->quantidade_processos - 1];
 
+  so_estat_t *estat = realloc(self->estat, (self->n_estat + 1) * sizeof(*estat));
+  if (estat != NULL)
+  {
+    self->estat = estat;
+    processo_carregado->estat = self->n_estat;
+    estat = &self->estat[self->n_estat++];
+    strncpy(estat->nome, processo_carregado->nome, sizeof(estat->nome));
+    estat->pid = processo_carregado->pid;
+    estat->faltas = 0;
+    estat->copias = 0;
+    estat->substituidas = 0;
+    estat->gravadas = 0;
+    estat->limpas = 0;
+    estat->antecipadas = 0;
+    estat->acertos = 0;
+    estat->desperdicios = 0;
+    estat->ultima_falta = -1;
+    estat->janela = ANTECIPA_JANELA_INI;
+    estat->antecipada_ini = 0;
+    estat->antecipada_fim = -1;
+  }
+
   char so_message[200];
   sprintf(so_message, "SO: Processo criado Nome: %s PID: %d", processo_carregado->nome, processo_carregado->pid);
 
@@ -544,11 +781,27 @@ static void so_chamada_cria_proc(so_t *self)
   {
     processo_t *processo_criado = so_cria_processo(self, nome);
     int ender_carga = so_carrega_programa(self, nome, processo_criado);
-
-    // deveria escrever no PC do descritor do processo criado
-    processo_criado->estado_cpu.registradorPC = ender_carga;
-    processo_atual->estado_cpu.registradorA = processo_criado->pid;
-    mem_escreve(self->mem, IRQ_END_A, processo_criado->pid);
+    int pid_criado = processo_criado->pid;
+    if (ender_carga < 0)
+    {
+      // o programa não foi carregado: o processo criado não vai executar
+      console_printf(self->console, "SO: Removendo processo %s PID: %d da tabela", processo_criado->nome, pid_criado);
+      so_libera_memoria(self, processo_criado);
+      remove_processo_tabela(self->tabela_processos, pid_criado);
+      pid_criado = -1;
+    }
+    else
+    {
+      // deveria escrever no PC do descritor do processo criado
+      processo_criado->estado_cpu.registradorPC = ender_carga;
+    }
+    // a criação pode ter mudado a tabela de processos de lugar
+    processo_atual = encontrar_processo_por_pid(self->tabela_processos, id_processo_executando);
+    processo_atual->estado_cpu.registradorA = pid_criado;
+    cpu_estado_t estado;
+    cpu_pega_estado(self->cpu, &estado);
+    estado.A = pid_criado;
+    cpu_define_estado(self->cpu, &estado);
     return;
   }
   // deveria escrever -1 (se erro) ou 0 (se OK) no reg A do processo que
@@ -584,64 +837,842 @@ static void so_chamada_mata_proc(so_t *self)
     return;
   }
   console_printf(self->console, "SO: Removendo processo %s PID: %d da tabela", processo_atual->nome, processo_atual->pid);
+  so_estat_t *estat = so_estat_do_processo(self, processo_atual);
+  if (estat != NULL)
+  {
+    so_imprime_estat(self, estat);
+  }
+  so_libera_memoria(self, processo_atual);
   remove_processo_tabela(self->tabela_processos, id_processo_executando);
 }
 
-// carrega o programa na memória
-// retorna o endereço de carga ou -1
-// está simplesmente lendo para o próximo quadro que nunca foi ocupado,
-//   nem testa se tem memória disponível
-// com memória virtual, a forma mais simples de implementar a carga
-//   de um programa é carregá-lo para a memória secundária, e mapear
-//   todas as páginas da tabela de páginas como inválidas. assim,
-//   as páginas serão colocadas na memória principal por demanda.
-//   para simplificar ainda mais, a memória secundária pode ser alocada
-//   da forma como a principal está sendo alocada aqui (sem reuso)
-static int so_carrega_programa(so_t *self, char *nome_do_executavel, processo_t *processo)
+// retorna um vetor com 'n_paginas' quadros livres da memória secundária,
+//   que passam a estar ocupados, ou NULL se não houver tantos
+static int *so_aloca_secundaria(so_t *self, int n_paginas)
+{
+  if (quadros_n_livres(self->quadros_secundarios) < n_paginas)
+  {
+    return NULL;
+  }
+  int *quadros = malloc((n_paginas > 0 ? n_paginas : 1) * sizeof(int));
+  if (quadros == NULL)
+  {
+    return NULL;
+  }
+  for (int i = 0; i < n_paginas; i++)
+  {
+    quadros[i] = quadros_aloca(self->quadros_secundarios);
+  }
+  return quadros;
+}
+
+// devolve ao alocador os 'n_paginas' quadros da memória secundária que
+//   estão no vetor (o vetor não é liberado)
+static void so_libera_secundaria(so_t *self, int *quadros, int n_paginas)
 {
+  for (int i = 0; i < n_paginas; i++)
+  {
+    quadros_libera(self->quadros_secundarios, quadros[i]);
+  }
+}
+
+// retorna a imagem (índice em self->imagens) do programa 'nome'
+// na primeira vez, o programa é lido para quadros livres da memória
+//   secundária, que ficam com a imagem; nas outras, a imagem é reusada
+// retorna -1 em caso de erro
+static int so_imagem_do_programa(so_t *self, char *nome)
+{
+  for (int i = 0; i < self->n_imagens; i++)
+  {
+    if (strcmp(self->imagens[i].nome, nome) == 0)
+    {
+      return i;
+    }
+  }
   // programa para executar na nossa CPU
-  programa_t *prog = prog_cria(nome_do_executavel);
+  programa_t *prog = prog_cria(nome);
   if (prog == NULL)
   {
     console_printf(self->console,
-                   "Erro na leitura do programa '%s'\n", nome_do_executavel);
+                   "Erro na leitura do programa '%s'\n", nome);
     return -1;
   }
 
   int end_virt_ini = prog_end_carga(prog);
   int end_virt_fim = end_virt_ini + prog_tamanho(prog) - 1;
-  int pagina_ini = end_virt_ini / TAM_PAGINA;
-  int pagina_fim = end_virt_fim / TAM_PAGINA;
-  int quadro_ini = self->quadro_livre;
-  // mapeia as páginas nos quadros
-  int quadro = quadro_ini;
-  for (int pagina = pagina_ini; pagina <= pagina_fim; pagina++)
+  int pagina_ini = PAGINA_DO_END(end_virt_ini);
+  int pagina_fim = PAGINA_DO_END(end_virt_fim);
+  int n_paginas = pagina_fim - pagina_ini + 1;
+  // as páginas são copiadas inteiras para a memória principal, então têm
+  //   que estar inteiras na secundária
+  int *quadro_sec = so_aloca_secundaria(self, n_paginas);
+  if (quadro_sec == NULL)
+  {
+    console_printf(self->console,
+                   "Erro na carga de '%s': memória secundária cheia\n", nome);
+    prog_destroi(prog);
+    return -1;
+  }
+  int *quadro = malloc(n_paginas * sizeof(int));
+  so_imagem_t *imagens = realloc(self->imagens,
+                                 (self->n_imagens + 1) * sizeof(so_imagem_t));
+  if (quadro == NULL || imagens == NULL)
+  {
+    free(quadro);
+    if (imagens != NULL)
+    {
+      self->imagens = imagens;
+    }
+    so_libera_secundaria(self, quadro_sec, n_paginas);
+    free(quadro_sec);
+    prog_destroi(prog);
+    return -1;
+  }
+  self->imagens = imagens;
+  // cada página vai para o seu quadro; o que não é do programa na primeira
+  //   e na última página fica zerado (o quadro pode ter sido de um processo)
+  for (int i = 0; i < n_paginas; i++)
+  {
+    int end_ini = END_DA_PAGINA(pagina_ini + i);
+    int end_fim = end_ini + TAM_PAGINA - 1;
+    if (end_ini < end_virt_ini)
+    {
+      end_ini = end_virt_ini;
+    }
+    if (end_fim > end_virt_fim)
+    {
+      end_fim = end_virt_fim;
+    }
+    mem_preenche(self->mem_secundaria, END_DA_PAGINA(quadro_sec[i]), 0,
+                 TAM_PAGINA);
+    mem_escreve_bloco(self->mem_secundaria,
+                      END_DA_PAGINA(quadro_sec[i]) + DESLOC_DO_END(end_ini),
+                      prog_dados(prog) + (end_ini - end_virt_ini),
+                      end_fim - end_ini + 1);
+    quadro[i] = -1;
+  }
+
+  so_imagem_t *imagem = &self->imagens[self->n_imagens];
+  strncpy(imagem->nome, nome, sizeof(imagem->nome) - 1);
+  imagem->nome[sizeof(imagem->nome) - 1] = '\0';
+  imagem->end_ini = end_virt_ini;
+  imagem->end_fim = end_virt_fim;
+  imagem->pagina_ini = pagina_ini;
+  imagem->pagina_fim = pagina_fim;
+  imagem->quadro_secundario = quadro_sec;
+  imagem->quadro = quadro;
+  // se o programa foi traduzido para C e ligado ao simulador, a CPU
+  //   executa a tradução quando estiver com a tabela de páginas de um
+  //   processo que executa o programa
+  imagem->trad = trad_acha(nome, prog);
+  prog_destroi(prog);
+  console_printf(self->console,
+                 "SO: imagem de '%s' em %d quadros da memória secundária",
+                 nome, n_paginas);
+  return self->n_imagens++;
+}
+
+// carrega o programa para o processo
+// retorna o endereço de carga ou -1
+// o processo passa a usar a imagem do programa, e todas as páginas dele
+//   ficam ausentes na tabela de páginas do processo; elas são colocadas na
+//   memória principal por demanda (so_carrega_pagina)
+// o processo recebe uma área com um quadro livre da memória secundária para
+//   cada página, que só é escrito quando a página, alterada por ele, sai da
+//   memória principal
+static int so_carrega_programa(so_t *self, char *nome_do_executavel, processo_t *processo)
+{
+  int i_imagem = so_imagem_do_programa(self, nome_do_executavel);
+  if (i_imagem == -1)
+  {
+    return -1;
+  }
+  so_imagem_t *imagem = &self->imagens[i_imagem];
+  int n_paginas = imagem->pagina_fim - imagem->pagina_ini + 1;
+  int *quadro_sec = so_aloca_secundaria(self, n_paginas);
+  if (quadro_sec == NULL)
+  {
+    console_printf(self->console,
+                   "Erro na carga de '%s': memória secundária cheia\n",
+                   nome_do_executavel);
+    return -1;
+  }
+  bool *privada = calloc(n_paginas, sizeof(bool));
+  if (privada == NULL)
+  {
+    so_libera_secundaria(self, quadro_sec, n_paginas);
+    free(quadro_sec);
+    return -1;
+  }
+
+  processo->imagem = i_imagem;
+  processo->pagina_ini = imagem->pagina_ini;
+  processo->pagina_fim = imagem->pagina_fim;
+  processo->quadro_secundario = quadro_sec;
+  processo->privada = privada;
+  // todas as páginas do programa começam ausentes
+  tabpag_define_tamanho(processo->tabpag, imagem->pagina_fim + 1);
+  cpu_associa_traduzido(self->cpu, processo->tabpag, imagem->trad);
+  console_printf(self->console,
+                 "SO: carga de '%s' em V%d-%d, área do processo com %d "
+                 "quadros da memória secundária (%d livres)",
+                 nome_do_executavel, imagem->end_ini, imagem->end_fim,
+                 n_paginas, quadros_n_livres(self->quadros_secundarios));
+  return imagem->end_ini;
+}
+
+// registra que a página 'pagina' do processo foi colocada no quadro
+static void so_ocupa_quadro(so_t *self, int quadro, processo_t *processo,
+                            int pagina, bool compartilhado)
+{
+  int i = pagina - processo->pagina_ini;
+  so_quadro_t *conteudo = &self->conteudo_quadro[quadro];
+  conteudo->imagem = processo->imagem;
+  conteudo->pagina = pagina;
+  conteudo->compartilhado = compartilhado;
+  // um quadro compartilhado não é de nenhum processo, e não é gravado
+  if (compartilhado)
+  {
+    conteudo->quadro_secundario = -1;
+    conteudo->privada = NULL;
+  }
+  else
+  {
+    conteudo->quadro_secundario = processo->quadro_secundario[i];
+    conteudo->privada = &processo->privada[i];
+  }
+  conteudo->antecipada_por = -1;
+  conteudo->acesso_politica = false;
+  conteudo->acesso_limpador = false;
+  conteudo->ociosidade = 0;
+  subst_ocupa(self->subst, quadro);
+}
+
+// retorna o número que identifica o processo como dono no mapa reverso
+//   (a posição dos contadores dele, que não muda), ou -1
+static int so_dono_do_processo(so_t *self, processo_t *processo)
+{
+  return processo->estat;
+}
+
+// mapeia a página do processo no quadro, registrando no mapa reverso; uma
+//   página compartilhada só pode ser lida e executada
+static void so_mapeia_pagina(so_t *self, processo_t *processo, int pagina,
+                             int quadro, bool compartilhada)
+{
+  quadros_mapeia(self->quadros, quadro, processo->tabpag, pagina,
+                 so_dono_do_processo(self, processo));
+  if (compartilhada)
+  {
+    tabpag_define_protecao(processo->tabpag, pagina,
+                           PAG_LEITURA | PAG_EXECUCAO);
+  }
+}
+
+// coloca a página 'pagina' do processo na memória principal e mapeia ela na
+//   tabela de páginas do processo
+// uma página que o processo não alterou é a da imagem, que é mapeada no
+//   quadro compartilhado, se já estiver em um; senão é copiada da memória
+//   secundária (da imagem ou da área do processo) para um quadro livre (ou,
+//   se não for leitura antecipada, liberado pela política de substituição)
+// retorna false se a página não é do programa do processo, ou se não há
+//   quadro para ela
+static bool so_coloca_pagina(so_t *self, processo_t *processo, int pagina,
+                             bool antecipada)
+{
+  if (pagina < processo->pagina_ini || pagina > processo->pagina_fim)
+  {
+    return false;
+  }
+  int i = pagina - processo->pagina_ini;
+  so_imagem_t *imagem = &self->imagens[processo->imagem];
+  bool compartilhada = !processo->privada[i]
+                       && tabpag_quadro_compartilhavel();
+  int quadro = compartilhada ? imagem->quadro[i] : -1;
+  bool reusada = quadro != -1;
+  if (!reusada)
+  {
+    // a leitura antecipada não tira outra página da memória
+    quadro = antecipada ? quadros_aloca(self->quadros) : so_aloca_quadro(self);
+    if (quadro == -1)
+    {
+      if (!antecipada)
+      {
+        console_printf(self->console,
+                       "SO: sem quadro livre para a página %d de %s",
+                       pagina, processo->nome);
+      }
+      return false;
+    }
+    int quadro_sec = processo->privada[i]
+                     ? processo->quadro_secundario[i]
+                     : imagem->quadro_secundario[i];
+    mem_copia(self->mem, END_DA_PAGINA(quadro), self->mem_secundaria,
+              END_DA_PAGINA(quadro_sec), TAM_PAGINA);
+    so_ocupa_quadro(self, quadro, processo, pagina, compartilhada);
+    if (compartilhada)
+    {
+      imagem->quadro[i] = quadro;
+    }
+    so_estat_t *estat = so_estat_do_processo(self, processo);
+    if (antecipada && estat != NULL)
+    {
+      self->conteudo_quadro[quadro].antecipada_por = estat - self->estat;
+      estat->antecipadas++;
+    }
+  }
+  so_mapeia_pagina(self, processo, pagina, quadro, compartilhada);
+  if (antecipada)
+  {
+    console_printf(self->console,
+                   "SO: leitura antecipada da página %d de %s, %s quadro %d",
+                   pagina, processo->nome,
+                   reusada ? "compartilhada no" : "no", quadro);
+  }
+  else
+  {
+    console_printf(self->console,
+                   "SO: falta de página %d de %s, %s quadro %d",
+                   pagina, processo->nome,
+                   reusada ? "compartilhada no" : "carregada no", quadro);
+  }
+  return true;
+}
+
+// a página no quadro foi usada: se foi lida antecipadamente, conta o
+//   acerto para quem a leu, e aumenta a janela dele
+static void so_usa_antecipada(so_t *self, int quadro)
+{
+  so_quadro_t *conteudo = &self->conteudo_quadro[quadro];
+  if (conteudo->antecipada_por == -1)
+  {
+    return;
+  }
+  so_estat_t *estat = &self->estat[conteudo->antecipada_por];
+  estat->acertos++;
+  estat->janela *= 2;
+  if (estat->janela > ANTECIPA_JANELA_MAX)
+  {
+    estat->janela = ANTECIPA_JANELA_MAX;
+  }
+  conteudo->antecipada_por = -1;
+}
+
+// se a página no quadro foi lida antecipadamente e já foi acessada, conta
+//   o acerto
+// tem que ser chamada antes de os bits de acesso do quadro serem zerados
+static void so_confere_antecipada(so_t *self, int quadro)
+{
+  if (so_quadro_acessado(self, quadro))
+  {
+    so_usa_antecipada(self, quadro);
+  }
+}
+
+// o quadro vai ser liberado: se a página nele foi lida antecipadamente e
+//   não foi usada, conta o desperdício para quem a leu, e diminui a janela
+static void so_descarta_antecipada(so_t *self, int quadro)
+{
+  so_confere_antecipada(self, quadro);
+  so_quadro_t *conteudo = &self->conteudo_quadro[quadro];
+  if (conteudo->antecipada_por == -1)
+  {
+    return;
+  }
+  so_estat_t *estat = &self->estat[conteudo->antecipada_por];
+  estat->desperdicios++;
+  estat->janela /= 2;
+  if (estat->janela < 1)
+  {
+    estat->janela = 1;
+  }
+  conteudo->antecipada_por = -1;
+}
+
+// trata a falta da página 'pagina' do processo: coloca a página na memória
+//   e, se o acesso parece sequencial, lê antecipadamente as seguintes
+// retorna false se a página não pôde ser colocada na memória
+static bool so_carrega_pagina(so_t *self, processo_t *processo, int pagina)
+{
+  if (!so_coloca_pagina(self, processo, pagina, false))
+  {
+    return false;
+  }
+  so_estat_t *estat = so_estat_do_processo(self, processo);
+  if (estat == NULL)
+  {
+    return true;
+  }
+  estat->faltas++;
+  // as páginas da antecipação anterior que foram usadas aumentam a janela
+  //   antes de ela ser usada de novo
+  for (int p = estat->antecipada_ini; p <= estat->antecipada_fim; p++)
+  {
+    int endfis;
+    if (tabpag_traduz(processo->tabpag, END_DA_PAGINA(p), &endfis) == ERR_OK)
+    {
+      so_confere_antecipada(self, PAGINA_DO_END(endfis));
+    }
+  }
+  bool sequencial = pagina == estat->ultima_falta + 1;
+  estat->ultima_falta = pagina;
+  if (!sequencial)
+  {
+    return true;
+  }
+  estat->antecipada_ini = pagina + 1;
+  estat->antecipada_fim = pagina;
+  for (int p = pagina + 1;
+       p <= pagina + estat->janela && p <= processo->pagina_fim; p++)
+  {
+    int endfis;
+    err_t err = tabpag_traduz(processo->tabpag, END_DA_PAGINA(p), &endfis);
+    if (err == ERR_PAG_AUSENTE)
+    {
+      if (!so_coloca_pagina(self, processo, p, true))
+      {
+        break;
+      }
+    }
+    estat->antecipada_fim = p;
+    estat->ultima_falta = p;
+  }
+  return true;
+}
+
+// trata a escrita do processo em uma página compartilhada (que causou
+//   ERR_PROT): copia a página para um quadro só do processo, onde ela pode
+//   ser alterada
+// retorna false se a página não é compartilhada (a escrita é mesmo
+//   proibida), ou se não há quadro para a cópia
+static bool so_copia_na_escrita(so_t *self, processo_t *processo, int pagina)
+{
+  int endfis;
+  if (tabpag_traduz(processo->tabpag, END_DA_PAGINA(pagina), &endfis) != ERR_OK
+      || !self->conteudo_quadro[PAGINA_DO_END(endfis)].compartilhado)
+  {
+    return false;
+  }
+  // a escrita não marca o acesso, mas usou a página, que pode ter sido
+  //   lida antecipadamente (e o quadro dela pode ser a vítima, abaixo)
+  so_usa_antecipada(self, PAGINA_DO_END(endfis));
+  int quadro = so_aloca_quadro(self);
+  if (quadro == -1)
+  {
+    console_printf(self->console,
+                   "SO: sem quadro livre para a cópia da página %d de %s",
+                   pagina, processo->nome);
+    return false;
+  }
+  // o quadro compartilhado pode ter sido a vítima da substituição; nesse
+  //   caso a cópia é feita da imagem, que nunca é alterada
+  int i = pagina - processo->pagina_ini;
+  so_imagem_t *imagem = &self->imagens[processo->imagem];
+  if (imagem->quadro[i] != -1)
+  {
+    mem_copia(self->mem, END_DA_PAGINA(quadro), self->mem,
+              END_DA_PAGINA(imagem->quadro[i]), TAM_PAGINA);
+  }
+  else
+  {
+    mem_copia(self->mem, END_DA_PAGINA(quadro), self->mem_secundaria,
+              END_DA_PAGINA(imagem->quadro_secundario[i]), TAM_PAGINA);
+  }
+  so_ocupa_quadro(self, quadro, processo, pagina, false);
+  so_mapeia_pagina(self, processo, pagina, quadro, false);
+  // a cópia só existe na memória principal: se sair dela antes da escrita
+  //   que causou a cópia, tem que ser gravada na área do processo
+  tabpag_marca_bit_acesso(processo->tabpag, pagina, true);
+  so_estat_t *estat = so_estat_do_processo(self, processo);
+  if (estat != NULL)
+  {
+    estat->copias++;
+  }
+  console_printf(self->console,
+                 "SO: cópia na escrita da página %d de %s, no quadro %d",
+                 pagina, processo->nome, quadro);
+  return true;
+}
+
+// retorna um quadro para colocar uma página: um livre ou, se não houver,
+//   um escolhido pela política de substituição, que é liberado
+// retorna -1 se não houver quadro (memória sem quadros para usuário)
+static int so_aloca_quadro(so_t *self)
+{
+  int quadro = quadros_aloca(self->quadros);
+  if (quadro != -1)
+  {
+    return quadro;
+  }
+  int vitima = subst_vitima(self->subst);
+  if (vitima == -1)
+  {
+    return -1;
+  }
+  so_retira_pagina(self, vitima);
+  return quadros_aloca(self->quadros);
+}
+
+// funções usadas pela política de substituição para ver os bits de acesso
+//   e alteração da página em um quadro, em todas as tabelas em que ela está
+//   (pelo mapa reverso)
+static bool so_quadro_acessado(void *arg, int quadro)
+{
+  so_t *self = arg;
+  if (self->conteudo_quadro[quadro].acesso_politica)
+  {
+    return true;
+  }
+  int n = quadros_n_mapeamentos(self->quadros, quadro);
+  for (int i = 0; i < n; i++)
+  {
+    tabpag_t *tabpag;
+    int pagina, dono;
+    quadros_mapeamento(self->quadros, quadro, i, &tabpag, &pagina, &dono);
+    if (tabpag_bit_acesso(tabpag, pagina))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool so_quadro_alterado(void *arg, int quadro)
+{
+  so_t *self = arg;
+  int n = quadros_n_mapeamentos(self->quadros, quadro);
+  for (int i = 0; i < n; i++)
   {
-    tabpag_define_quadro(processo->tabpag, pagina, quadro);
-    quadro++;
+    tabpag_t *tabpag;
+    int pagina, dono;
+    quadros_mapeamento(self->quadros, quadro, i, &tabpag, &pagina, &dono);
+    if (tabpag_bit_alteracao(tabpag, pagina))
+    {
+      return true;
+    }
   }
-  self->quadro_livre = quadro;
+  return false;
+}
 
-  mmu_define_tabpag(self->mmu, processo->tabpag);
+static void so_quadro_zera_acesso(void *arg, int quadro)
+{
+  so_t *self = arg;
+  so_confere_antecipada(self, quadro);
+  so_quadro_t *conteudo = &self->conteudo_quadro[quadro];
+  if (so_zera_bits_acesso(self, quadro))
+  {
+    conteudo->acesso_limpador = true;
+  }
+  conteudo->acesso_politica = false;
+}
 
-  // carrega o programa na memória principal
-  int end_fis_ini = quadro_ini * TAM_PAGINA;
-  int end_fis = end_fis_ini;
-  for (int end_virt = end_virt_ini; end_virt <= end_virt_fim; end_virt++)
+// zera o bit de acesso da página no quadro em todas as tabelas
+// retorna true se algum estava ligado
+static bool so_zera_bits_acesso(so_t *self, int quadro)
+{
+  bool acessado = false;
+  int n = quadros_n_mapeamentos(self->quadros, quadro);
+  for (int i = 0; i < n; i++)
   {
-    if (mem_escreve(self->mem, end_fis, prog_dado(prog, end_virt)) != ERR_OK)
+    tabpag_t *tabpag;
+    int pagina, dono;
+    quadros_mapeamento(self->quadros, quadro, i, &tabpag, &pagina, &dono);
+    if (tabpag_bit_acesso(tabpag, pagina))
     {
+      tabpag_zera_bit_acesso(tabpag, pagina);
+      acessado = true;
+    }
+  }
+  return acessado;
+}
+
+// retira da memória principal a página que está no quadro, de todas as
+//   tabelas em que está mapeada (pelo mapa reverso)
+// uma cópia privada que foi alterada é gravada na área do processo na
+//   memória secundária; uma página compartilhada continua na imagem
+static void so_retira_pagina(so_t *self, int quadro)
+{
+  so_descarta_antecipada(self, quadro);
+  so_quadro_t *conteudo = &self->conteudo_quadro[quadro];
+  if (conteudo->compartilhado)
+  {
+    so_imagem_t *imagem = &self->imagens[conteudo->imagem];
+    imagem->quadro[conteudo->pagina - imagem->pagina_ini] = -1;
+  }
+  int n = quadros_n_mapeamentos(self->quadros, quadro);
+  for (int i = 0; i < n; i++)
+  {
+    tabpag_t *tabpag;
+    int pagina, dono;
+    quadros_mapeamento(self->quadros, quadro, i, &tabpag, &pagina, &dono);
+    bool gravada = !conteudo->compartilhado
+                   && tabpag_bit_alteracao(tabpag, pagina);
+    if (gravada)
+    {
+      mem_copia(self->mem_secundaria,
+                END_DA_PAGINA(conteudo->quadro_secundario),
+                self->mem, END_DA_PAGINA(quadro), TAM_PAGINA);
+      *conteudo->privada = true;
+    }
+    if (dono != -1)
+    {
+      so_estat_t *estat = &self->estat[dono];
+      estat->substituidas++;
+      if (gravada)
+      {
+        estat->gravadas++;
+      }
       console_printf(self->console,
-                     "Erro na carga da memória, end virt %d fís %d\n", end_virt, end_fis);
-      return -1;
+                     "SO: página %d de %s retirada do quadro %d%s", pagina,
+                     estat->nome, quadro, gravada ? ", gravada" : "");
     }
-    end_fis++;
   }
-  prog_destroi(prog);
+  quadros_desmapeia_todos(self->quadros, quadro);
+  conteudo->imagem = -1;
+  subst_libera(self->subst, quadro);
+  quadros_libera(self->quadros, quadro);
+}
+
+// desfaz os mapeamentos das páginas do processo, que está terminando, e
+//   devolve aos alocadores os quadros das páginas privadas dele e os da
+//   área dele na memória secundária; destrói a tabela de páginas do
+//   processo
+// os quadros compartilhados continuam com a imagem
+static void so_libera_memoria(so_t *self, processo_t *processo)
+{
+  tabpag_t *tabpag = processo->tabpag;
+  for (int pagina = processo->pagina_ini; pagina <= processo->pagina_fim;
+       pagina++)
+  {
+    int endfis;
+    if (tabpag_traduz(tabpag, END_DA_PAGINA(pagina), &endfis) == ERR_OK)
+    {
+      int quadro = PAGINA_DO_END(endfis);
+      bool compartilhado = self->conteudo_quadro[quadro].compartilhado;
+      // um quadro compartilhado fica na memória, e ainda pode ser usado
+      if (compartilhado)
+      {
+        so_confere_antecipada(self, quadro);
+      }
+      else
+      {
+        so_descarta_antecipada(self, quadro);
+      }
+      quadros_desmapeia(self->quadros, tabpag, pagina);
+      if (!compartilhado)
+      {
+        self->conteudo_quadro[quadro].imagem = -1;
+        subst_libera(self->subst, quadro);
+        quadros_libera(self->quadros, quadro);
+      }
+    }
+  }
+  // o que o processo gravou na área dele não vai mais ser lido
+  if (processo->quadro_secundario != NULL)
+  {
+    so_libera_secundaria(self, processo->quadro_secundario,
+                         processo->pagina_fim - processo->pagina_ini + 1);
+  }
+  // ninguém mais pode usar a tabela; os contadores do processo ficam
+  if (mmu_tabpag(self->mmu) == tabpag)
+  {
+    mmu_define_tabpag(self->mmu, NULL);
+  }
+  cpu_associa_traduzido(self->cpu, tabpag, NULL);
+  destroi_processo(processo);
   console_printf(self->console,
-                 "SO: carga de '%s' em V%d-%d F%d-%d", nome_do_executavel,
-                 end_virt_ini, end_virt_fim, end_fis_ini, end_fis - 1);
-  return end_virt_ini;
+                 "SO: memória de %s liberada, %d quadros livres, "
+                 "fragmentação %d%%, %d quadros livres na secundária",
+                 processo->nome, quadros_n_livres(self->quadros),
+                 quadros_fragmentacao(self->quadros),
+                 quadros_n_livres(self->quadros_secundarios));
+}
+
+// grava na área do processo a cópia privada que está no quadro, se ela foi
+//   alterada, e zera o bit de alteração; assim, quando o quadro for
+//   liberado, ela não precisa mais ser gravada (se não for alterada de novo)
+// retorna true se gravou
+static bool so_limpa_quadro(so_t *self, int quadro)
+{
+  so_quadro_t *conteudo = &self->conteudo_quadro[quadro];
+  if (conteudo->imagem == -1 || conteudo->compartilhado
+      || quadros_n_mapeamentos(self->quadros, quadro) == 0)
+  {
+    return false;
+  }
+  tabpag_t *tabpag;
+  int pagina, dono;
+  quadros_mapeamento(self->quadros, quadro, 0, &tabpag, &pagina, &dono);
+  if (!tabpag_bit_alteracao(tabpag, pagina))
+  {
+    return false;
+  }
+  mem_copia(self->mem_secundaria, END_DA_PAGINA(conteudo->quadro_secundario),
+            self->mem, END_DA_PAGINA(quadro), TAM_PAGINA);
+  *conteudo->privada = true;
+  tabpag_zera_bit_alteracao(tabpag, pagina);
+  if (dono != -1)
+  {
+    self->estat[dono].limpas++;
+  }
+  return true;
+}
+
+// limpador de páginas, executado a cada interrupção do relógio
+// só trabalha quando a memória está quase cheia (até o dobro da reserva de
+//   quadros livres); com memória sobrando, gravar páginas é desperdício
+// examina o quadro, zerando os bits de acesso da página, e retorna há
+//   quantos exames seguidos ela não é acessada
+static int so_ociosidade_do_quadro(so_t *self, int quadro)
+{
+  so_quadro_t *conteudo = &self->conteudo_quadro[quadro];
+  if (so_zera_bits_acesso(self, quadro))
+  {
+    conteudo->acesso_politica = true;
+    conteudo->acesso_limpador = true;
+  }
+  if (conteudo->acesso_limpador)
+  {
+    conteudo->acesso_limpador = false;
+    conteudo->ociosidade = 0;
+  }
+  else
+  {
+    conteudo->ociosidade++;
+  }
+  return conteudo->ociosidade;
+}
+
+// grava no máximo orcamento_limpeza páginas: primeiro as cópias privadas
+//   alteradas que não foram acessadas nos últimos LIMPEZA_OCIOSIDADE exames,
+//   examinando alguns quadros a partir de onde parou da última vez; depois,
+//   enquanto houver menos de reserva_livres quadros livres, libera o quadro
+//   escolhido pela política de substituição, gravando antes a página se
+//   ela foi alterada
+static void so_limpa_paginas(so_t *self)
+{
+  if (quadros_n_livres(self->quadros) > 2 * self->reserva_livres)
+  {
+    return;
+  }
+  int gravadas = 0;
+  // não examina todos os quadros a cada interrupção
+  int n_examinar = 8 * self->orcamento_limpeza;
+  if (n_examinar > self->n_quadros)
+  {
+    n_examinar = self->n_quadros;
+  }
+  for (int n = 0; n < n_examinar && gravadas < self->orcamento_limpeza; n++)
+  {
+    int quadro = self->ponteiro_limpeza;
+    self->ponteiro_limpeza = (quadro + 1) % self->n_quadros;
+    if (self->conteudo_quadro[quadro].imagem == -1)
+    {
+      continue;
+    }
+    if (so_ociosidade_do_quadro(self, quadro) >= LIMPEZA_OCIOSIDADE
+        && so_limpa_quadro(self, quadro))
+    {
+      gravadas++;
+    }
+  }
+  while (quadros_n_livres(self->quadros) < self->reserva_livres
+         && gravadas < self->orcamento_limpeza)
+  {
+    int vitima = subst_vitima(self->subst);
+    if (vitima == -1)
+    {
+      break;
+    }
+    if (so_limpa_quadro(self, vitima))
+    {
+      gravadas++;
+    }
+    so_retira_pagina(self, vitima);
+    self->liberados_limpeza++;
+  }
+}
+
+void so_define_limpeza(so_t *self, int orcamento, int reserva)
+{
+  self->orcamento_limpeza = orcamento;
+  self->reserva_livres = reserva;
+}
+
+// retorna os contadores do processo, ou NULL se ele não tem
+static so_estat_t *so_estat_do_processo(so_t *self, processo_t *processo)
+{
+  if (processo->estat == -1)
+  {
+    return NULL;
+  }
+  return &self->estat[processo->estat];
+}
+
+static void so_imprime_estat(so_t *self, so_estat_t *estat)
+{
+  console_printf(self->console,
+                 "SO: %s: %d faltas de página, %d cópias na escrita, "
+                 "%d páginas substituídas, %d gravadas na substituição, "
+                 "%d pelo limpador", estat->nome, estat->faltas,
+                 estat->copias, estat->substituidas, estat->gravadas,
+                 estat->limpas);
+  console_printf(self->console,
+                 "SO: %s: %d páginas lidas antecipadamente, %d usadas, "
+                 "%d descartadas sem uso", estat->nome, estat->antecipadas,
+                 estat->acertos, estat->desperdicios);
+}
+
+void so_relatorio(so_t *self, FILE *arq)
+{
+  int faltas = 0, copias = 0, substituidas = 0, gravadas = 0, limpas = 0;
+  int antecipadas = 0, acertos = 0, desperdicios = 0;
+  for (int i = 0; i < self->n_estat; i++)
+  {
+    antecipadas += self->estat[i].antecipadas;
+    acertos += self->estat[i].acertos;
+    desperdicios += self->estat[i].desperdicios;
+    faltas += self->estat[i].faltas;
+    copias += self->estat[i].copias;
+    limpas += self->estat[i].limpas;
+    substituidas += self->estat[i].substituidas;
+    gravadas += self->estat[i].gravadas;
+  }
+  fprintf(arq, "SO: substituição '%s', %d quadros: %d faltas de página, "
+               "%d cópias na escrita, %d páginas substituídas, %d gravadas\n",
+          subst_nome(subst_politica(self->subst)), self->n_quadros,
+          faltas, copias, substituidas, gravadas);
+  fprintf(arq, "SO: limpador (%d páginas por interrupção, reserva de %d "
+               "quadros): %d páginas gravadas, %d quadros liberados\n",
+          self->orcamento_limpeza, self->reserva_livres, limpas,
+          self->liberados_limpeza);
+  fprintf(arq, "SO: leitura antecipada: %d páginas, %d usadas, "
+               "%d descartadas sem uso\n", antecipadas, acertos, desperdicios);
+  int compartilhados = 0;
+  for (int quadro = 0; quadro < self->n_quadros; quadro++)
+  {
+    if (self->conteudo_quadro[quadro].imagem != -1
+        && self->conteudo_quadro[quadro].compartilhado)
+    {
+      compartilhados++;
+    }
+  }
+  fprintf(arq, "SO: %d imagens de programa, %d quadros compartilhados\n",
+          self->n_imagens, compartilhados);
+  fprintf(arq, "SO: %d de %d quadros livres, fragmentação %d%%\n",
+          quadros_n_livres(self->quadros),
+          quadros_n_alocaveis(self->quadros),
+          quadros_fragmentacao(self->quadros));
+  for (int i = 0; i < self->n_estat; i++)
+  {
+    so_estat_t *estat = &self->estat[i];
+    fprintf(arq, "SO:   %d %-12s %6d faltas %6d cópias %6d substituídas "
+                 "%6d gravadas %6d limpas %6d antecipadas %6d usadas "
+                 "%6d sem uso\n", estat->pid, estat->nome,
+            estat->faltas, estat->copias, estat->substituidas,
+            estat->gravadas, estat->limpas, estat->antecipadas,
+            estat->acertos, estat->desperdicios);
+  }
 }
 
 // copia uma string da memória do processo para o vetor str.
@@ -660,13 +1691,20 @@ static int so_carrega_programa(so_t *self, char *nome_do_executavel, processo_t
 static bool so_copia_str_do_processo(so_t *self, int tam, char str[tam],
                                      int end_virt, processo_t *processo)
 {
-  // TODO: pegar tabela de páginas do processo e usar aqui
+  // o processo é o que fez a chamada, a MMU está com a tabela de páginas
+  //   dele
   for (int indice_str = 0; indice_str < tam; indice_str++)
   {
     int caractere;
-    // não tem memória virtual implementada, posso usar a mmu para traduzir
-    //   os endereços e acessar a memória
-    if (mmu_le(self->mmu, end_virt + indice_str, &caractere, usuario) != ERR_OK)
+    int end = end_virt + indice_str;
+    err_t err = mmu_le(self->mmu, end, &caractere, usuario);
+    // a página pode não estar na memória principal ainda
+    if (err == ERR_PAG_AUSENTE
+        && so_carrega_pagina(self, processo, PAGINA_DO_END(end)))
+    {
+      err = mmu_le(self->mmu, end, &caractere, usuario);
+    }
+    if (err != ERR_OK)
     {
       return false;
     }
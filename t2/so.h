@@ -12,11 +12,32 @@ typedef struct so_t so_t;
 #include "cpu.h"
 #include "console.h"
 #include "relogio.h"
+#include "substituicao.h"
+#include <stdio.h>
 
+// cria o SO, que usa a política 'politica' para escolher as páginas que
+//   saem da memória principal quando ela estiver cheia
 so_t *so_cria(cpu_t *cpu, mem_t *mem, mem_t *mem_secundaria, mmu_t *mmu,
-              console_t *console, relogio_t *relogio);
+              console_t *console, relogio_t *relogio,
+              subst_politica_t politica);
 void so_destroi(so_t *self);
 
+// configura o limpador de páginas, que a cada interrupção do relógio grava
+//   na memória secundária até 'orcamento' páginas alteradas que não estão
+//   sendo usadas, e libera quadros até ter 'reserva' quadros livres, para
+//   que uma falta de página não precise esperar a gravação de outra página
+// com 'orcamento' 0, o limpador não faz nada
+// sem essa chamada, são usados os valores abaixo
+void so_define_limpeza(so_t *self, int orcamento, int reserva);
+#define SO_LIMPEZA_ORCAMENTO 4
+#define SO_LIMPEZA_RESERVA 2
+
+// imprime em 'arq' os contadores de memória virtual (faltas de página,
+//   páginas substituídas e gravadas na memória secundária, na substituição
+//   ou pelo limpador, páginas lidas antecipadamente e quantas delas foram
+//   usadas), no total e de cada processo criado
+void so_relatorio(so_t *self, FILE *arq);
+
 // Chamadas de sistema
 // Uma chamada de sistema é realizada colocando a identificação da
 //   chamada (um dos valores abaixo) no registrador A e executando a
@@ -0,0 +1,229 @@
+#include "substituicao.h"
+#include <stdlib.h>
+#include <string.h>
+
+// o que se sabe de cada quadro
+typedef struct {
+  bool ocupado;
+  long carga;        // ordem em que a página foi colocada no quadro
+  unsigned idade;    // contador do envelhecimento, 8 bits
+} quadro_t;
+
+struct subst_t {
+  subst_politica_t politica;
+  int n_quadros;
+  quadro_t *quadros;
+  int n_ocupados;
+  long n_cargas;
+  int ponteiro;      // próximo quadro a examinar (relógio e NRU)
+  subst_bits_t bits;
+  void *arg;
+};
+
+// cada política escolhe a vítima e, se precisar, faz algo periodicamente
+typedef struct {
+  char *nome;
+  int (*vitima)(subst_t *self);
+  void (*tictac)(subst_t *self);
+} politica_t;
+
+// ---------------------------------------------------------------------
+// funções auxiliares
+
+// retorna o bit de acesso da página no quadro (que está ocupado)
+static bool subst__acessada(subst_t *self, int quadro)
+{
+  return self->bits.acessado(self->arg, quadro);
+}
+
+// zera o bit de acesso da página no quadro, se estiver marcado
+// zerar um bit tira a página da TLB, então não é feito à toa
+static void subst__zera_acesso(subst_t *self, int quadro)
+{
+  if (subst__acessada(self, quadro)) self->bits.zera_acesso(self->arg, quadro);
+}
+
+// avança o ponteiro para o quadro seguinte, circularmente
+static void subst__avanca(subst_t *self)
+{
+  self->ponteiro = (self->ponteiro + 1) % self->n_quadros;
+}
+
+// ---------------------------------------------------------------------
+// políticas
+
+static int subst__vitima_fifo(subst_t *self)
+{
+  int vitima = -1;
+  for (int i = 0; i < self->n_quadros; i++) {
+    quadro_t *q = &self->quadros[i];
+    if (!q->ocupado) continue;
+    if (vitima == -1 || q->carga < self->quadros[vitima].carga) vitima = i;
+  }
+  return vitima;
+}
+
+static int subst__vitima_relogio(subst_t *self)
+{
+  // na segunda volta, todos os bits de acesso estão zerados
+  for (;;) {
+    int i = self->ponteiro;
+    quadro_t *q = &self->quadros[i];
+    subst__avanca(self);
+    if (!q->ocupado) continue;
+    if (!subst__acessada(self, i)) return i;
+    self->bits.zera_acesso(self->arg, i);
+  }
+}
+
+// classe da página no quadro para o NRU: 0 a 3, pelos bits de acesso
+//   (mais significativo) e de alteração
+static int subst__classe_nru(subst_t *self, int quadro)
+{
+  return (subst__acessada(self, quadro) ? 2 : 0)
+         + (self->bits.alterado(self->arg, quadro) ? 1 : 0);
+}
+
+static int subst__vitima_nru(subst_t *self)
+{
+  // começa no ponteiro, para não escolher sempre os primeiros quadros
+  //   entre os da mesma classe
+  int vitima = -1;
+  int classe_vitima = 4;
+  for (int n = 0; n < self->n_quadros && classe_vitima > 0; n++) {
+    int i = (self->ponteiro + n) % self->n_quadros;
+    quadro_t *q = &self->quadros[i];
+    if (!q->ocupado) continue;
+    int classe = subst__classe_nru(self, i);
+    if (classe < classe_vitima) {
+      vitima = i;
+      classe_vitima = classe;
+    }
+  }
+  if (vitima != -1) self->ponteiro = (vitima + 1) % self->n_quadros;
+  return vitima;
+}
+
+static void subst__tictac_nru(subst_t *self)
+{
+  for (int i = 0; i < self->n_quadros; i++) {
+    if (self->quadros[i].ocupado) subst__zera_acesso(self, i);
+  }
+}
+
+static int subst__vitima_envelhecimento(subst_t *self)
+{
+  // o bit de acesso atual entraria no contador como o mais significativo,
+  //   então vale mais que o contador todo; no empate, a mais antiga
+  int vitima = -1;
+  unsigned idade_vitima = 0;
+  for (int i = 0; i < self->n_quadros; i++) {
+    quadro_t *q = &self->quadros[i];
+    if (!q->ocupado) continue;
+    unsigned idade = (subst__acessada(self, i) ? 0x100 : 0) | q->idade;
+    if (vitima == -1 || idade < idade_vitima
+        || (idade == idade_vitima && q->carga < self->quadros[vitima].carga)) {
+      vitima = i;
+      idade_vitima = idade;
+    }
+  }
+  return vitima;
+}
+
+static void subst__tictac_envelhecimento(subst_t *self)
+{
+  for (int i = 0; i < self->n_quadros; i++) {
+    quadro_t *q = &self->quadros[i];
+    if (!q->ocupado) continue;
+    q->idade = (q->idade >> 1) | (subst__acessada(self, i) ? 0x80 : 0);
+    subst__zera_acesso(self, i);
+  }
+}
+
+static politica_t politicas[N_SUBST] = {
+  [SUBST_FIFO]           = { "fifo", subst__vitima_fifo, NULL },
+  [SUBST_RELOGIO]        = { "relogio", subst__vitima_relogio, NULL },
+  [SUBST_NRU]            = { "nru", subst__vitima_nru, subst__tictac_nru },
+  [SUBST_ENVELHECIMENTO] = { "envelhecimento", subst__vitima_envelhecimento,
+                             subst__tictac_envelhecimento },
+};
+
+// ---------------------------------------------------------------------
+// API
+
+char *subst_nome(subst_politica_t politica)
+{
+  if (politica < 0 || politica >= N_SUBST) return "?";
+  return politicas[politica].nome;
+}
+
+bool subst_politica_do_nome(char *nome, subst_politica_t *ppolitica)
+{
+  for (int p = 0; p < N_SUBST; p++) {
+    if (strcmp(nome, politicas[p].nome) == 0) {
+      *ppolitica = p;
+      return true;
+    }
+  }
+  return false;
+}
+
+subst_t *subst_cria(subst_politica_t politica, int n_quadros,
+                    subst_bits_t bits, void *arg)
+{
+  subst_t *self = malloc(sizeof(*self));
+  if (self == NULL) return NULL;
+  self->quadros = calloc(n_quadros > 0 ? n_quadros : 1, sizeof(quadro_t));
+  if (self->quadros == NULL) {
+    free(self);
+    return NULL;
+  }
+  self->politica = politica;
+  self->n_quadros = n_quadros;
+  self->n_ocupados = 0;
+  self->n_cargas = 0;
+  self->ponteiro = 0;
+  self->bits = bits;
+  self->arg = arg;
+  return self;
+}
+
+void subst_destroi(subst_t *self)
+{
+  free(self->quadros);
+  free(self);
+}
+
+subst_politica_t subst_politica(subst_t *self)
+{
+  return self->politica;
+}
+
+void subst_ocupa(subst_t *self, int quadro)
+{
+  quadro_t *q = &self->quadros[quadro];
+  if (!q->ocupado) self->n_ocupados++;
+  q->ocupado = true;
+  q->carga = self->n_cargas++;
+  q->idade = 0;
+}
+
+void subst_libera(subst_t *self, int quadro)
+{
+  quadro_t *q = &self->quadros[quadro];
+  if (q->ocupado) self->n_ocupados--;
+  q->ocupado = false;
+}
+
+int subst_vitima(subst_t *self)
+{
+  if (self->n_ocupados == 0) return -1;
+  return politicas[self->politica].vitima(self);
+}
+
+void subst_tictac(subst_t *self)
+{
+  if (politicas[self->politica].tictac != NULL) {
+    politicas[self->politica].tictac(self);
+  }
+}
@@ -0,0 +1,83 @@
+#ifndef SUBSTITUICAO_H
+#define SUBSTITUICAO_H
+
+// substituição de páginas
+// estrutura auxiliar do SO, que registra quais quadros da memória principal
+//   estão ocupados e, quando não há mais quadro livre, escolhe o quadro cuja
+//   página vai sair da memória (a vítima), conforme uma política
+// as políticas que usam o uso recente das páginas consultam os bits de
+//   acesso e alteração das tabelas de páginas através de funções do SO,
+//   porque só ele sabe em quais tabelas está mapeado cada quadro (uma página
+//   compartilhada está em várias)
+
+#include <stdbool.h>
+
+// as políticas de substituição
+typedef enum {
+  SUBST_FIFO,           // a página que está há mais tempo na memória
+  SUBST_RELOGIO,        // segunda chance: como FIFO, mas uma página
+                        //   acessada desde a última passagem do ponteiro
+                        //   tem o bit de acesso zerado e fica
+  SUBST_NRU,            // não usada recentemente: a página da menor classe
+                        //   pelos bits de acesso e alteração, que são
+                        //   zerados periodicamente (subst_tictac)
+  SUBST_ENVELHECIMENTO, // a página com o menor contador de uso, que recebe
+                        //   periodicamente o bit de acesso (subst_tictac)
+  N_SUBST
+} subst_politica_t;
+
+#define SUBST_PADRAO SUBST_FIFO
+
+// retorna o nome da política (usado para escolhê-la na linha de comando)
+char *subst_nome(subst_politica_t politica);
+
+// coloca em '*ppolitica' a política de nome 'nome'
+// retorna false se não existir política com esse nome
+bool subst_politica_do_nome(char *nome, subst_politica_t *ppolitica);
+
+// tipo opaco que representa o estado da substituição
+typedef struct subst_t subst_t;
+
+// funções de acesso aos bits das páginas que estão em um quadro, chamadas
+//   com o argumento 'arg' passado na criação
+typedef struct {
+  // retorna true se a página no quadro foi acessada em alguma tabela
+  bool (*acessado)(void *arg, int quadro);
+  // retorna true se a página no quadro foi alterada
+  bool (*alterado)(void *arg, int quadro);
+  // zera o bit de acesso da página no quadro em todas as tabelas
+  void (*zera_acesso)(void *arg, int quadro);
+} subst_bits_t;
+
+// cria o controle de substituição para uma memória de 'n_quadros' quadros,
+//   todos inicialmente livres, com a política 'politica'
+// 'bits' dá acesso aos bits de acesso e alteração dos quadros ocupados
+// retorna NULL em caso de erro
+subst_t *subst_cria(subst_politica_t politica, int n_quadros,
+                    subst_bits_t bits, void *arg);
+
+// destrói o controle de substituição
+void subst_destroi(subst_t *self);
+
+// retorna a política em uso
+subst_politica_t subst_politica(subst_t *self);
+
+// registra que uma página foi colocada no quadro
+void subst_ocupa(subst_t *self, int quadro);
+
+// registra que o quadro ficou livre
+void subst_libera(subst_t *self, int quadro);
+
+// escolhe, entre os quadros ocupados, aquele cuja página deve sair da
+//   memória, conforme a política
+// a política pode zerar bits de acesso, mas não altera o quadro; quem
+//   chama retira a página dele e registra a nova (subst_ocupa)
+// retorna -1 se não houver quadro ocupado
+int subst_vitima(subst_t *self);
+
+// deve ser chamada periodicamente (a cada interrupção do relógio)
+// as políticas que acompanham o uso recente das páginas registram os bits
+//   de acesso das páginas e os zeram
+void subst_tictac(subst_t *self);
+
+#endif // SUBSTITUICAO_H
@@ -5,117 +5,504 @@
 
 typedef struct {
   int quadro;
+  int prot;
   bool acessada;
   bool alterada;
 } descritor_t;
 
+#ifdef TABPAG_INVERTIDA
+// tabela invertida: uma só tabela, compartilhada por todas as tabpag_t,
+//   com uma entrada por quadro da memória física, que diz qual página de
+//   qual tabpag_t está nele; a entrada de uma página é achada pelo hash de
+//   (asid, página), e as entradas com o mesmo hash são encadeadas
+// o tamanho só depende da memória física, não dos espaços de endereçamento;
+//   em compensação, um quadro só pode estar mapeado em uma página
+typedef struct {
+  descritor_t descritor;  // quadro -1 se o quadro não está em uso
+  tabpag_t *dono;
+  int pagina;
+  int proximo;            // próximo quadro com o mesmo hash, ou -1
+} entrada_inv_t;
+
+static entrada_inv_t *quadros = NULL;
+// primeiro quadro da lista de cada valor de hash, ou -1
+static int *hash = NULL;
+static int tam_hash = 0;  // potência de 2
+#else
+// a tabela é uma árvore de 3 níveis (raiz, meio e folha), indexada por
+//   partes do número da página; só existem os nós que contêm alguma página
+//   mapeada, e cada nó conta quantos filhos (ou páginas mapeadas, na folha)
+//   ele tem, para ser liberado quando ficar vazio
+// com páginas de pelo menos 8 palavras, os 28 bits cobrem todos os
+//   endereços positivos
+#define BITS_FOLHA 9
+#define BITS_MEIO 9
+#define BITS_RAIZ 10
+#define TAM_FOLHA (1 << BITS_FOLHA)
+#define TAM_MEIO (1 << BITS_MEIO)
+#define TAM_RAIZ (1 << BITS_RAIZ)
+#define N_PAGINAS (TAM_RAIZ * TAM_MEIO * TAM_FOLHA)
+
+// índices da página em cada nível
+#define IND_RAIZ(pag) ((pag) >> (BITS_MEIO + BITS_FOLHA))
+#define IND_MEIO(pag) (((pag) >> BITS_FOLHA) & (TAM_MEIO - 1))
+#define IND_FOLHA(pag) ((pag) & (TAM_FOLHA - 1))
+
+typedef struct {
+  descritor_t descritor[TAM_FOLHA];
+  int n_mapeadas;
+} folha_t;
+
+typedef struct {
+  folha_t *folha[TAM_MEIO];
+  int n_folhas;
+} meio_t;
+#endif
+
 struct tabpag_t {
-  descritor_t *tabela;
-  int tam_tab;
+#ifndef TABPAG_INVERTIDA
+  meio_t **raiz;  // TAM_RAIZ ponteiros, ou NULL se não há página mapeada
+  int n_meios;
+#endif
+  int tamanho;    // número de páginas do espaço de endereçamento
+  int limite;     // o maior entre tamanho e 1 + a maior página mapeada
+  unsigned versao;
+  unsigned asid;
+  tabpag_f_alteracao_t obs_alteracao;
+  void *arg_obs;
 };
 
+// fonte das versões das tabelas; é global para que duas tabelas diferentes
+//   (mesmo que uma ocupe a memória de outra já destruída) nunca tenham
+//   a mesma versão
+static unsigned ultima_versao = 0;
+
+// fonte dos identificadores das tabelas, pelo mesmo motivo
+static unsigned ultimo_asid = 0;
+
+// número de quadros (inteiros) da memória física; só quadros menores que
+//   este podem ser mapeados
+static int n_quadros = 0;
+
+// log2 de TAM_PAGINA_PADRAO
+#define BITS_PAGINA_PADRAO 4
+_Static_assert((1 << BITS_PAGINA_PADRAO) == TAM_PAGINA_PADRAO,
+               "BITS_PAGINA_PADRAO não corresponde a TAM_PAGINA_PADRAO");
+
+int tabpag_bits_pagina = BITS_PAGINA_PADRAO;
+
+bool tabpag_define_tam_pagina(int tam)
+{
+  if (tam < TAM_PAGINA_MIN || tam > TAM_PAGINA_MAX) return false;
+  if ((tam & (tam - 1)) != 0) return false;
+  int bits = 0;
+  while ((1 << bits) < tam) bits++;
+  tabpag_bits_pagina = bits;
+  return true;
+}
+
+// informa ao observador que a página foi alterada
+static void tabpag__notifica(tabpag_t *self, int pagina)
+{
+  if (self->obs_alteracao != NULL) {
+    self->obs_alteracao(self->arg_obs, self, pagina);
+  }
+}
+
 tabpag_t *tabpag_cria(void)
 {
   tabpag_t *self = malloc(sizeof(*self));
   if (self == NULL) return self;
-  self->tabela = NULL;
-  self->tam_tab = 0;
+#ifndef TABPAG_INVERTIDA
+  self->raiz = NULL;
+  self->n_meios = 0;
+#endif
+  self->tamanho = 0;
+  self->limite = 0;
+  self->versao = ++ultima_versao;
+  self->asid = ++ultimo_asid;
+  self->obs_alteracao = NULL;
+  self->arg_obs = NULL;
   return self;
 }
 
+// retorna a maior página mapeada na tabela antes de 'pagina', ou -1 se
+//   não houver (depende da implementação)
+static int tabpag__mapeada_anterior(tabpag_t *self, int pagina);
+
+// recalcula o limite da tabela, depois que 'pagina' deixou de estar mapeada
+static void tabpag__reduz_limite(tabpag_t *self, int pagina)
+{
+  if (pagina != self->limite - 1 || pagina < self->tamanho) return;
+  int limite = tabpag__mapeada_anterior(self, pagina) + 1;
+  self->limite = limite > self->tamanho ? limite : self->tamanho;
+}
+
+#ifdef TABPAG_INVERTIDA
+
+// (re)cria a tabela invertida, com uma entrada para cada quadro
+static void tabpag__cria_invertida(void)
+{
+  free(quadros);
+  free(hash);
+  tam_hash = 1;
+  while (tam_hash < n_quadros) tam_hash *= 2;
+  quadros = malloc(n_quadros * sizeof(entrada_inv_t));
+  hash = malloc(tam_hash * sizeof(int));
+  assert(quadros != NULL && hash != NULL);
+  for (int q = 0; q < n_quadros; q++) {
+    quadros[q].descritor.quadro = -1;
+    quadros[q].dono = NULL;
+  }
+  for (int h = 0; h < tam_hash; h++) {
+    hash[h] = -1;
+  }
+}
+
+static int tabpag__hash(tabpag_t *self, int pagina)
+{
+  unsigned h = ((unsigned)pagina ^ (self->asid << 16)) * 0x9E3779B1u;
+  return (h ^ (h >> 16)) & (tam_hash - 1);
+}
+
+// retorna o quadro onde está a página, ou -1 se ela não estiver mapeada
+static int tabpag__quadro_da_pagina(tabpag_t *self, int pagina)
+{
+  if (pagina < 0 || pagina >= self->limite) return -1;
+  int q = hash[tabpag__hash(self, pagina)];
+  while (q != -1) {
+    if (quadros[q].dono == self && quadros[q].pagina == pagina) return q;
+    q = quadros[q].proximo;
+  }
+  return -1;
+}
+
+// retorna o descritor da página, ou NULL se ela não estiver mapeada
+static descritor_t *tabpag__descritor(tabpag_t *self, int pagina)
+{
+  int q = tabpag__quadro_da_pagina(self, pagina);
+  if (q == -1) return NULL;
+  return &quadros[q].descritor;
+}
+
+static int tabpag__mapeada_anterior(tabpag_t *self, int pagina)
+{
+  int maior = -1;
+  for (int q = 0; q < n_quadros; q++) {
+    if (quadros[q].dono == self && quadros[q].pagina < pagina
+        && quadros[q].pagina > maior) {
+      maior = quadros[q].pagina;
+    }
+  }
+  return maior;
+}
+
+// retira o quadro 'q' da página que está nele
+static void tabpag__libera_quadro(int q)
+{
+  entrada_inv_t *entrada = &quadros[q];
+  tabpag_t *dono = entrada->dono;
+  int *pq = &hash[tabpag__hash(dono, entrada->pagina)];
+  while (*pq != q) pq = &quadros[*pq].proximo;
+  *pq = entrada->proximo;
+  entrada->descritor.quadro = -1;
+  entrada->dono = NULL;
+  tabpag__reduz_limite(dono, entrada->pagina);
+}
+
+static void tabpag__remove_pagina(tabpag_t *self, int pagina)
+{
+  int q = tabpag__quadro_da_pagina(self, pagina);
+  if (q != -1) tabpag__libera_quadro(q);
+}
+
+// retorna o descritor do quadro (que existe), colocando a página nele
+// se o quadro estava com outra página, ela deixa de estar mapeada (e o
+//   observador da tabela dela é avisado)
+static descritor_t *tabpag__insere_pagina(tabpag_t *self, int pagina,
+                                          int quadro)
+{
+  entrada_inv_t *entrada = &quadros[quadro];
+  if (entrada->dono == self && entrada->pagina == pagina) {
+    return &entrada->descritor;
+  }
+  tabpag__remove_pagina(self, pagina);
+  if (entrada->dono != NULL) {
+    tabpag_t *outro = entrada->dono;
+    int outra_pagina = entrada->pagina;
+    tabpag__libera_quadro(quadro);
+    outro->versao = ++ultima_versao;
+    tabpag__notifica(outro, outra_pagina);
+  }
+  int h = tabpag__hash(self, pagina);
+  entrada->dono = self;
+  entrada->pagina = pagina;
+  entrada->proximo = hash[h];
+  hash[h] = quadro;
+  if (pagina >= self->limite) self->limite = pagina + 1;
+  return &entrada->descritor;
+}
+
 void tabpag_destroi(tabpag_t *self)
 {
-  if (self->tabela != NULL) free(self->tabela);
+  for (int q = 0; q < n_quadros; q++) {
+    if (quadros[q].dono == self) tabpag__libera_quadro(q);
+  }
   free(self);
 }
 
+#else
+
+void tabpag_destroi(tabpag_t *self)
+{
+  if (self->raiz != NULL) {
+    for (int r = 0; r < TAM_RAIZ; r++) {
+      meio_t *meio = self->raiz[r];
+      if (meio == NULL) continue;
+      for (int m = 0; m < TAM_MEIO; m++) {
+        if (meio->folha[m] != NULL) free(meio->folha[m]);
+      }
+      free(meio);
+    }
+    free(self->raiz);
+  }
+  free(self);
+}
+
+// retorna a folha que contém a página, ou NULL se ela não existir
+static folha_t *tabpag__folha(tabpag_t *self, int pagina)
+{
+  if (pagina < 0 || pagina >= self->limite || self->raiz == NULL) {
+    return NULL;
+  }
+  meio_t *meio = self->raiz[IND_RAIZ(pagina)];
+  if (meio == NULL) return NULL;
+  return meio->folha[IND_MEIO(pagina)];
+}
+
+// retorna o descritor da página, ou NULL se ela não estiver mapeada
+static descritor_t *tabpag__descritor(tabpag_t *self, int pagina)
+{
+  folha_t *folha = tabpag__folha(self, pagina);
+  if (folha == NULL) return NULL;
+  descritor_t *descritor = &folha->descritor[IND_FOLHA(pagina)];
+  if (descritor->quadro == -1) return NULL;
+  return descritor;
+}
+
+// pula as subárvores que não existem
+static int tabpag__mapeada_anterior(tabpag_t *self, int pagina)
+{
+  if (self->raiz == NULL) return -1;
+  for (int p = pagina - 1; p >= 0; p--) {
+    meio_t *meio = self->raiz[IND_RAIZ(p)];
+    if (meio == NULL) {
+      p = IND_RAIZ(p) << (BITS_MEIO + BITS_FOLHA);
+      continue;
+    }
+    folha_t *folha = meio->folha[IND_MEIO(p)];
+    if (folha == NULL) {
+      p = p & ~(TAM_FOLHA - 1);
+      continue;
+    }
+    if (folha->descritor[IND_FOLHA(p)].quadro != -1) return p;
+  }
+  return -1;
+}
+
 static void tabpag__remove_pagina(tabpag_t *self, int pagina)
 {
-  if (pagina >= self->tam_tab) return;
-  if (pagina < self->tam_tab - 1) {
-    self->tabela[pagina].quadro = -1;
-    return;
-  }
-  do {
-    self->tam_tab--;
-  } while (self->tam_tab > 0 && self->tabela[self->tam_tab - 1].quadro == -1);
-  if (self->tam_tab == 0) {
-    free(self->tabela);
-    self->tabela = NULL;
-  } else {
-    self->tabela = realloc(self->tabela, self->tam_tab * sizeof(descritor_t));
-    assert(self->tabela != NULL);
+  folha_t *folha = tabpag__folha(self, pagina);
+  if (folha == NULL) return;
+  descritor_t *descritor = &folha->descritor[IND_FOLHA(pagina)];
+  if (descritor->quadro == -1) return;
+  descritor->quadro = -1;
+  if (--folha->n_mapeadas == 0) {
+    meio_t *meio = self->raiz[IND_RAIZ(pagina)];
+    free(folha);
+    meio->folha[IND_MEIO(pagina)] = NULL;
+    if (--meio->n_folhas == 0) {
+      free(meio);
+      self->raiz[IND_RAIZ(pagina)] = NULL;
+      self->n_meios--;
+    }
+  }
+  tabpag__reduz_limite(self, pagina);
+  if (self->n_meios == 0) {
+    free(self->raiz);
+    self->raiz = NULL;
   }
 }
 
-static void tabpag__insere_pagina(tabpag_t *self, int pagina)
+// retorna o descritor da página, criando os nós que faltam até ela
+// (o quadro não importa para a árvore)
+static descritor_t *tabpag__insere_pagina(tabpag_t *self, int pagina,
+                                          int quadro)
 {
-  if (pagina < self->tam_tab) return;
-  int novo_tam = pagina + 1;
-  if (self->tam_tab == 0) {
-    self->tabela = malloc(novo_tam * sizeof(descritor_t));
-  } else {
-    self->tabela = realloc(self->tabela, novo_tam * sizeof(descritor_t));
+  assert(pagina >= 0 && pagina < N_PAGINAS);
+  if (self->raiz == NULL) {
+    self->raiz = calloc(TAM_RAIZ, sizeof(meio_t *));
+    assert(self->raiz != NULL);
   }
-  assert(self->tabela != NULL);
-  while (self->tam_tab < novo_tam) {
-    self->tabela[self->tam_tab].quadro = -1;
-    self->tam_tab++;
+  meio_t **pmeio = &self->raiz[IND_RAIZ(pagina)];
+  if (*pmeio == NULL) {
+    *pmeio = calloc(1, sizeof(meio_t));
+    assert(*pmeio != NULL);
+    self->n_meios++;
   }
+  folha_t **pfolha = &(*pmeio)->folha[IND_MEIO(pagina)];
+  if (*pfolha == NULL) {
+    *pfolha = malloc(sizeof(folha_t));
+    assert(*pfolha != NULL);
+    for (int i = 0; i < TAM_FOLHA; i++) {
+      (*pfolha)->descritor[i].quadro = -1;
+    }
+    (*pfolha)->n_mapeadas = 0;
+    (*pmeio)->n_folhas++;
+  }
+  descritor_t *descritor = &(*pfolha)->descritor[IND_FOLHA(pagina)];
+  if (descritor->quadro == -1) (*pfolha)->n_mapeadas++;
+  if (pagina >= self->limite) self->limite = pagina + 1;
+  return descritor;
 }
 
-void tabpag_define_quadro(tabpag_t *self, int pagina, int quadro)
+#endif
+
+void tabpag_define_memoria(int tam_mem)
 {
+  n_quadros = PAGINA_DO_END(tam_mem);
+#ifdef TABPAG_INVERTIDA
+  tabpag__cria_invertida();
+#endif
+}
+
+void tabpag_define_tamanho(tabpag_t *self, int n_paginas)
+{
+  self->tamanho = n_paginas;
+  int limite = tabpag__mapeada_anterior(self, self->limite) + 1;
+  self->limite = limite > n_paginas ? limite : n_paginas;
+  self->versao = ++ultima_versao;
+}
+
+err_t tabpag_define_quadro(tabpag_t *self, int pagina, int quadro)
+{
+  if (quadro != -1 && (quadro < 0 || quadro >= n_quadros)) {
+    return ERR_END_INV;
+  }
+  self->versao = ++ultima_versao;
   if (quadro == -1) {
     tabpag__remove_pagina(self, pagina);
   } else {
-    tabpag__insere_pagina(self, pagina);
-    self->tabela[pagina].quadro = quadro;
-    self->tabela[pagina].acessada = false;
-    self->tabela[pagina].alterada = false;
+    descritor_t *descritor = tabpag__insere_pagina(self, pagina, quadro);
+    descritor->quadro = quadro;
+    descritor->prot = PAG_RWX;
+    descritor->acessada = false;
+    descritor->alterada = false;
   }
+  tabpag__notifica(self, pagina);
+  return ERR_OK;
+}
+
+bool tabpag_quadro_compartilhavel(void)
+{
+#ifdef TABPAG_INVERTIDA
+  return false;
+#else
+  return true;
+#endif
+}
+
+void tabpag_define_protecao(tabpag_t *self, int pagina, int prot)
+{
+  descritor_t *descritor = tabpag__descritor(self, pagina);
+  if (descritor != NULL) {
+    descritor->prot = prot;
+    self->versao = ++ultima_versao;
+    tabpag__notifica(self, pagina);
+  }
+}
+
+int tabpag_protecao(tabpag_t *self, int pagina)
+{
+  descritor_t *descritor = tabpag__descritor(self, pagina);
+  if (descritor != NULL) {
+    return descritor->prot;
+  }
+  return 0;
 }
 
 void tabpag_marca_bit_acesso(tabpag_t *self, int pagina, bool alteracao)
 {
-  if (pagina < self->tam_tab) {
-    self->tabela[pagina].acessada = true;
+  descritor_t *descritor = tabpag__descritor(self, pagina);
+  if (descritor != NULL) {
+    descritor->acessada = true;
     if (alteracao) {
-      self->tabela[pagina].alterada = true;
+      descritor->alterada = true;
     }
   }
 }
 
 void tabpag_zera_bit_acesso(tabpag_t *self, int pagina)
 {
-  if (pagina < self->tam_tab) {
-    self->tabela[pagina].acessada = false;
+  descritor_t *descritor = tabpag__descritor(self, pagina);
+  if (descritor != NULL) {
+    descritor->acessada = false;
+    self->versao = ++ultima_versao;
+    tabpag__notifica(self, pagina);
+  }
+}
+
+void tabpag_zera_bit_alteracao(tabpag_t *self, int pagina)
+{
+  descritor_t *descritor = tabpag__descritor(self, pagina);
+  if (descritor != NULL) {
+    descritor->alterada = false;
+    self->versao = ++ultima_versao;
+    tabpag__notifica(self, pagina);
   }
 }
 
 bool tabpag_bit_acesso(tabpag_t *self, int pagina)
 {
-  if (pagina < self->tam_tab) {
-    return self->tabela[pagina].acessada;
+  descritor_t *descritor = tabpag__descritor(self, pagina);
+  if (descritor != NULL) {
+    return descritor->acessada;
   }
   return false;
 }
 
 bool tabpag_bit_alteracao(tabpag_t *self, int pagina)
 {
-  if (pagina < self->tam_tab) {
-    return self->tabela[pagina].alterada;
+  descritor_t *descritor = tabpag__descritor(self, pagina);
+  if (descritor != NULL) {
+    return descritor->alterada;
   }
   return false;
 }
 
+unsigned tabpag_versao(tabpag_t *self)
+{
+  return self->versao;
+}
+
+unsigned tabpag_asid(tabpag_t *self)
+{
+  return self->asid;
+}
+
+void tabpag_define_obs_alteracao(tabpag_t *self, tabpag_f_alteracao_t func,
+                                 void *arg)
+{
+  self->obs_alteracao = func;
+  self->arg_obs = arg;
+}
+
 err_t tabpag_traduz(tabpag_t *self, int endvirt, int *pendfis)
 {
-  int pagina = endvirt / TAM_PAGINA;
-  if (pagina >= self->tam_tab) return ERR_END_INV;
-  int quadro = self->tabela[pagina].quadro;
-  if (quadro == -1) return ERR_PAG_AUSENTE;
-  int deslocamento = endvirt % TAM_PAGINA;
-  *pendfis = quadro * TAM_PAGINA + deslocamento;
+  int pagina = PAGINA_DO_END(endvirt);
+  if (pagina < 0 || pagina >= self->limite) return ERR_END_INV;
+  descritor_t *descritor = tabpag__descritor(self, pagina);
+  if (descritor == NULL) return ERR_PAG_AUSENTE;
+  *pendfis = END_DA_PAGINA(descritor->quadro) | DESLOC_DO_END(endvirt);
   return ERR_OK;
 }
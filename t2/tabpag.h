@@ -10,7 +10,45 @@
 #include <stdbool.h>
 
 // tamanho de uma página, em palavras de memória
-#define TAM_PAGINA 10
+// é uma potência de 2, escolhida no início da execução (antes de criar
+//   qualquer tabela) com tabpag_define_tam_pagina; a página e o
+//   deslocamento de um endereço são obtidos com deslocamento e máscara
+#define TAM_PAGINA (1 << tabpag_bits_pagina)
+#define TAM_PAGINA_MIN 8
+#define TAM_PAGINA_MAX 4096
+#define TAM_PAGINA_PADRAO 16
+
+// número da página que contém o endereço 'end', e deslocamento dele nela
+// um endereço negativo resulta em página negativa
+#define PAGINA_DO_END(end) ((end) >> tabpag_bits_pagina)
+#define DESLOC_DO_END(end) ((end) & (TAM_PAGINA - 1))
+// primeiro endereço da página (ou quadro) 'pag'
+#define END_DA_PAGINA(pag) ((pag) << tabpag_bits_pagina)
+
+// log2 do tamanho da página; só deve ser alterado por
+//   tabpag_define_tam_pagina
+extern int tabpag_bits_pagina;
+
+// define o tamanho das páginas em 'tam' palavras
+// retorna false (e não altera o tamanho) se 'tam' não for uma potência de 2
+//   entre TAM_PAGINA_MIN e TAM_PAGINA_MAX
+bool tabpag_define_tam_pagina(int tam);
+
+// informa o tamanho da memória física, em palavras (chamada pela MMU)
+// tem que ser chamada depois de definir o tamanho das páginas e antes de
+//   criar qualquer tabela; só quadros que estão inteiros na memória podem
+//   ser mapeados, e quando as tabelas são implementadas por uma tabela
+//   invertida (TABPAG_INVERTIDA), ela tem uma entrada por quadro
+void tabpag_define_memoria(int tam_mem);
+
+// permissões de acesso a uma página, que podem ser combinadas com '|'
+// um acesso não permitido resulta em ERR_PROT (ver mmu.h)
+enum {
+  PAG_LEITURA  = 1,  // leitura de dados
+  PAG_ESCRITA  = 2,  // escrita de dados
+  PAG_EXECUCAO = 4,  // busca de instruções (opcode e argumento)
+  PAG_RWX      = PAG_LEITURA | PAG_ESCRITA | PAG_EXECUCAO,
+};
 
 // tipo opaco que representa a tabela de páginas
 typedef struct tabpag_t tabpag_t;
@@ -28,8 +66,36 @@ void tabpag_destroi(tabpag_t *self);
 // define a tradução da página 'pagina' deve resultar no quadro 'quadro'
 // se 'quadro' for -1, indica que a tradução não é possível, resultando em
 //   ERR_PAG_AUSENTE
-// os bits de acesso e alteração para essa página são zerados
-void tabpag_define_quadro(tabpag_t *self, int pagina, int quadro);
+// os bits de acesso e alteração para essa página são zerados, e ela fica
+//   com todas as permissões (PAG_RWX)
+// retorna ERR_END_INV (e não altera a tabela) se o quadro não estiver
+//   inteiro na memória física; assim, toda tradução bem sucedida resulta
+//   em um endereço físico válido, que não precisa ser verificado de novo
+// com a tabela invertida (TABPAG_INVERTIDA), um quadro só pode estar em
+//   uma página: se ele estava em outra (de qualquer tabela), ela deixa de
+//   estar mapeada
+err_t tabpag_define_quadro(tabpag_t *self, int pagina, int quadro);
+
+// retorna true se um quadro pode estar mapeado ao mesmo tempo em páginas de
+//   tabelas diferentes (memória compartilhada); false com a tabela invertida
+bool tabpag_quadro_compartilhavel(void);
+
+// define o número de páginas do espaço de endereçamento
+// as páginas de 0 a 'n_paginas' - 1 que não estão mapeadas em um quadro
+//   resultam em ERR_PAG_AUSENTE, e não em ERR_END_INV; é assim que o SO
+//   cria um espaço de endereçamento em que as páginas só vão para a
+//   memória principal quando são acessadas
+// as páginas mapeadas além desse número continuam válidas
+void tabpag_define_tamanho(tabpag_t *self, int n_paginas);
+
+// define as permissões de acesso à página (combinação de PAG_LEITURA,
+//   PAG_ESCRITA e PAG_EXECUCAO)
+// não faz nada se a página não estiver mapeada em algum quadro
+void tabpag_define_protecao(tabpag_t *self, int pagina, int prot);
+
+// retorna as permissões de acesso à página
+// retorna 0 se a página não estiver mapeada em algum quadro
+int tabpag_protecao(tabpag_t *self, int pagina);
 
 // marca o bit de acesso à página; se alteracao for true, marca também o
 //   bit de alteração
@@ -40,6 +106,11 @@ void tabpag_marca_bit_acesso(tabpag_t *self, int pagina, bool alteracao);
 // não faz nada se a página não estiver mapeada em algum quadro
 void tabpag_zera_bit_acesso(tabpag_t *self, int pagina);
 
+// zera o bit de alteração da página (depois de o SO gravar a página na
+//   memória secundária); não afeta o bit de acesso
+// não faz nada se a página não estiver mapeada em algum quadro
+void tabpag_zera_bit_alteracao(tabpag_t *self, int pagina);
+
 // retorna o valor do bit de acesso à página
 // retorna false se a página não estiver mapeada em algum quadro
 bool tabpag_bit_acesso(tabpag_t *self, int pagina);
@@ -48,11 +119,38 @@ bool tabpag_bit_acesso(tabpag_t *self, int pagina);
 // retorna false se a página não estiver mapeada em algum quadro
 bool tabpag_bit_alteracao(tabpag_t *self, int pagina);
 
+// retorna a versão da tabela, um número que muda cada vez que a tradução
+//   ou a proteção de uma página é alterada ou que um bit de acesso ou de
+//   alteração é zerado, e que não se repete entre tabelas diferentes
+// permite que quem guarda traduções fora da tabela (o JIT da CPU) saiba
+//   quando elas deixaram de valer
+unsigned tabpag_versao(tabpag_t *self);
+
+// retorna o identificador do espaço de endereçamento da tabela (ASID), um
+//   número diferente de 0 que não se repete entre tabelas diferentes
+// permite que a TLB da MMU guarde traduções de várias tabelas ao mesmo tempo
+unsigned tabpag_asid(tabpag_t *self);
+
+// tipo da função chamada quando a tradução ou a proteção de uma página é
+//   alterada ou um bit de acesso ou de alteração dela é zerado
+typedef void (*tabpag_f_alteracao_t)(void *arg, tabpag_t *tabpag, int pagina);
+
+// define uma função a ser chamada (com o argumento 'arg' e a página) após
+//   cada alteração na tradução de uma página (tabpag_define_quadro), na
+//   proteção dela (tabpag_define_protecao) ou nos bits de acesso e
+//   alteração dela (tabpag_zera_bit_acesso, tabpag_zera_bit_alteracao)
+// usado pela MMU para descartar as traduções que ela guardou na TLB
+// se 'func' for NULL, nenhuma função é chamada
+void tabpag_define_obs_alteracao(tabpag_t *self, tabpag_f_alteracao_t func,
+                                 void *arg);
+
 // traduz o endereço virtual 'endvirt'; coloca o endereço físico correspondente
 //   na posição apontada por 'pendfis'
 // retorna erro (e não altera '*pendfis') se a tradução não for possível:
-//   ERR_END_INV - página não existente na tabela de páginas
-//   ERR_PAG_AUSENTE - página marcada como ausente na tabela de páginas
+//   ERR_END_INV - página fora do espaço de endereçamento (além do tamanho
+//                 definido e da maior página mapeada)
+//   ERR_PAG_AUSENTE - página do espaço de endereçamento que não está
+//                     mapeada em um quadro
 err_t tabpag_traduz(tabpag_t *self, int endvirt, int *pendfis);
 
 #endif // TABPAG_H
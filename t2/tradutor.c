@@ -0,0 +1,398 @@
+// tradutor de programas em '.maq' para C, para serem ligados ao simulador
+//
+// chame como 'tradutor prog.maq > prog_trad.c' para traduzir um programa,
+//   ou 'tradutor -t prog1.maq prog2.maq ... > traduzidos.c' para gerar a
+//   tabela com os programas traduzidos que são ligados ao simulador
+//
+// o programa é percorrido a partir do endereço de início, seguindo os
+//   desvios e chamadas, para encontrar os inícios de blocos básicos
+//   (destinos de desvios, instruções após desvios condicionais e chamadas,
+//   retornos de chamadas de sistema); cada bloco vira uma função C, e os
+//   blocos são despachados por um switch no PC, que também resolve os
+//   retornos de subrotina (RET), que desviam para um endereço que está
+//   na memória
+// um bloco termina em um desvio, antes do início de outro bloco, ou antes
+//   de uma instrução que o código traduzido não executa (E/S, chamadas de
+//   sistema, instruções privilegiadas)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <ctype.h>
+
+#include "instrucao.h"
+#include "programa.h"
+
+// número máximo de instruções em um bloco
+// a CPU só executa um bloco se puder executar todas as instruções dele
+//   antes da próxima interrupção, blocos grandes seriam pouco usados
+#define MAX_INSTR_BLOCO 32
+
+// auxiliares
+
+// aborta o programa com uma mensagem de erro
+void erro_brabo(char *msg)
+{
+  fprintf(stderr, "ERRO FATAL: %s\n", msg);
+  exit(1);
+}
+
+// coloca em 'ident' o identificador C correspondente ao nome de arquivo
+//   'nome' (sem diretório e sem '.maq')
+void identificador(char *nome, char ident[100])
+{
+  char *barra = strrchr(nome, '/');
+  if (barra != NULL) nome = barra + 1;
+  int i;
+  for (i = 0; nome[i] != '\0' && i < 99; i++) {
+    ident[i] = isalnum(nome[i]) ? nome[i] : '_';
+  }
+  ident[i] = '\0';
+  int tam = strlen(ident);
+  if (tam > 4 && strcmp(ident + tam - 4, "_maq") == 0) ident[tam - 4] = '\0';
+}
+
+// programa
+
+programa_t *prog;
+int carga;        // endereço de carga do programa
+int tamanho;      // número de palavras do programa
+bool *eh_lider;   // se o endereço inicia um bloco
+bool *visitado;   // se já foi percorrida a instrução no endereço
+bool *eh_codigo;  // se a palavra é parte de uma instrução traduzida
+
+bool no_programa(int end)
+{
+  return end >= carga && end < carga + tamanho;
+}
+
+// retorna o número de palavras da instrução em 'end', ou 0 se não há uma
+//   instrução válida inteira no programa nesse endereço
+int tam_instrucao(int end)
+{
+  if (!no_programa(end)) return 0;
+  int opcode = prog_dado(prog, end);
+  if (opcode < NOP || opcode > CHAMAS) return 0;
+  int tam = 1 + instrucao_num_args(opcode);
+  if (!no_programa(end + tam - 1)) return 0;
+  return tam;
+}
+
+// se o código traduzido executa a instrução
+bool traduzivel(int opcode)
+{
+  switch (opcode) {
+    case PARA: case LE: case ESCR: case RETI: case CHAMAC: case CHAMAS:
+      return false;
+    default:
+      return true;
+  }
+}
+
+// se a instrução termina um bloco
+bool eh_desvio(int opcode)
+{
+  return opcode >= DESV && opcode <= RET;
+}
+
+// pilha de endereços a percorrer
+int *pendentes;
+int n_pendentes;
+
+void marca_lider(int end)
+{
+  if (!no_programa(end) || eh_lider[end - carga]) return;
+  eh_lider[end - carga] = true;
+  pendentes[n_pendentes++] = end;
+}
+
+// percorre o programa a partir de 'end', marcando os inícios de bloco
+void percorre(int end)
+{
+  for (;;) {
+    int tam = tam_instrucao(end);
+    if (tam == 0 || visitado[end - carga]) return;
+    visitado[end - carga] = true;
+    int opcode = prog_dado(prog, end);
+    int A1 = tam > 1 ? prog_dado(prog, end + 1) : 0;
+    switch (opcode) {
+      case DESV:
+        marca_lider(A1);
+        return;
+      case DESVZ: case DESVNZ: case DESVN: case DESVP:
+        marca_lider(A1);
+        marca_lider(end + tam);
+        return;
+      case CHAMA:
+        marca_lider(A1 + 1);
+        marca_lider(end + tam);
+        return;
+      case CHAMAS:
+        marca_lider(end + tam);
+        return;
+      case RET: case PARA: case LE: case ESCR: case RETI: case CHAMAC:
+        // RET volta para depois de um CHAMA, que já é início de bloco;
+        //   as outras causam erro em modo usuário
+        return;
+    }
+    end += tam;
+  }
+}
+
+void encontra_blocos(void)
+{
+  eh_lider = calloc(tamanho, sizeof(bool));
+  visitado = calloc(tamanho, sizeof(bool));
+  eh_codigo = calloc(tamanho, sizeof(bool));
+  pendentes = malloc(tamanho * sizeof(int));
+  if (!eh_lider || !visitado || !eh_codigo || !pendentes) {
+    erro_brabo("sem memória");
+  }
+  n_pendentes = 0;
+  marca_lider(prog_end_inicio(prog));
+  while (n_pendentes > 0) {
+    percorre(pendentes[--n_pendentes]);
+  }
+}
+
+// geração de código
+
+// número de instruções do bloco que inicia em 'ini', e endereço do fim
+int tam_bloco(int ini, int *pfim)
+{
+  int end = ini;
+  int n = 0;
+  while (n < MAX_INSTR_BLOCO) {
+    int tam = tam_instrucao(end);
+    if (tam == 0) break;
+    int opcode = prog_dado(prog, end);
+    if (!traduzivel(opcode)) break;
+    if (n > 0 && eh_lider[end - carga]) break;
+    n++;
+    end += tam;
+    if (eh_desvio(opcode)) break;
+  }
+  *pfim = end;
+  return n;
+}
+
+// gera o código da instrução em 'end', a 'k'-ésima do bloco
+// retorna true se a instrução termina o bloco
+bool gera_instrucao(int end, int k)
+{
+  int opcode = prog_dado(prog, end);
+  int tam = tam_instrucao(end);
+  int A1 = tam > 1 ? prog_dado(prog, end + 1) : 0;
+  int seg = end + tam;
+  for (int i = 0; i < tam; i++) eh_codigo[end + i - carga] = true;
+
+  if (tam > 1) {
+    printf("  // %04d: %s %d\n", end, instrucao_nome(opcode), A1);
+  } else {
+    printf("  // %04d: %s\n", end, instrucao_nome(opcode));
+  }
+  printf("  TRAD_BUSCA(%d, %d, %d);\n", end, tam, k);
+  switch (opcode) {
+    case NOP:
+      break;
+    case CARGI:
+      printf("  A = %d;\n", A1);
+      break;
+    case CARGM:
+      printf("  TRAD_LE(%d, v, %d, %d);\n", A1, end, k);
+      printf("  A = v;\n");
+      break;
+    case CARGX:
+      printf("  TRAD_LE(%d + X, v, %d, %d);\n", A1, end, k);
+      printf("  A = v;\n");
+      break;
+    case ARMM:
+      printf("  TRAD_ESCREVE(%d, A, %d, %d);\n", A1, end, k);
+      printf("  TRAD_VERIFICA_ALTERADO(%d, %d);\n", seg, k);
+      break;
+    case ARMX:
+      printf("  TRAD_ESCREVE(%d + X, A, %d, %d);\n", A1, end, k);
+      printf("  TRAD_VERIFICA_ALTERADO(%d, %d);\n", seg, k);
+      break;
+    case TRAX:
+      printf("  v = A; A = X; X = v;\n");
+      break;
+    case CPXA:
+      printf("  A = X;\n");
+      break;
+    case INCX:
+      printf("  X += 1;\n");
+      break;
+    case SOMA:
+    case SUB:
+    case MULT:
+    case DIV:
+    case RESTO: {
+      char *op[] = { [SOMA] = "+=", [SUB] = "-=", [MULT] = "*=",
+                     [DIV] = "/=", [RESTO] = "%=" };
+      printf("  TRAD_LE(%d, v, %d, %d);\n", A1, end, k);
+      printf("  A %s v;\n", op[opcode]);
+      break;
+    }
+    case NEG:
+      printf("  A = -A;\n");
+      break;
+    case DESV:
+      printf("  TRAD_SAI(%d, %d);\n", A1, k + 1);
+      return true;
+    case DESVZ:
+    case DESVNZ:
+    case DESVN:
+    case DESVP: {
+      char *cond[] = { [DESVZ] = "==", [DESVNZ] = "!=", [DESVN] = "<",
+                       [DESVP] = ">" };
+      printf("  if (A %s 0) TRAD_SAI(%d, %d);\n", cond[opcode], A1, k + 1);
+      printf("  TRAD_SAI(%d, %d);\n", seg, k + 1);
+      return true;
+    }
+    case CHAMA:
+      printf("  TRAD_ESCREVE(%d, %d, %d, %d);\n", A1, seg, end, k);
+      printf("  TRAD_SAI(%d, %d);\n", A1 + 1, k + 1);
+      return true;
+    case RET:
+      printf("  TRAD_LE(%d, v, %d, %d);\n", A1, end, k);
+      printf("  TRAD_SAI(v, %d);\n", k + 1);
+      return true;
+  }
+  return false;
+}
+
+void gera_bloco(int ini)
+{
+  int fim;
+  int n = tam_bloco(ini, &fim);
+  printf("\n// bloco %04d-%04d, %d instruções\n", ini, fim - 1, n);
+  printf("static int bloco_%04d(trad_estado_t *e)\n{\n", ini);
+  printf("  TRAD_INICIO;\n");
+  int end = ini;
+  bool desviou = false;
+  for (int k = 0; k < n; k++) {
+    desviou = gera_instrucao(end, k);
+    end += tam_instrucao(end);
+  }
+  if (!desviou) {
+    printf("  TRAD_SAI(%d, %d);\n", end, n);
+  }
+  printf("}\n");
+}
+
+void gera_tabela(char *nome, bool *tab)
+{
+  printf("\nstatic const unsigned char %s[%d] = {", nome, tamanho);
+  for (int i = 0; i < tamanho; i++) {
+    if (i % 20 == 0) printf("\n ");
+    printf(" %d,", tab[i]);
+  }
+  printf("\n};\n");
+}
+
+void gera_programa(char *nome)
+{
+  char ident[100];
+  identificador(nome, ident);
+  char *barra = strrchr(nome, '/');
+
+  printf("// %s traduzido para C pelo tradutor -- não altere\n\n", nome);
+  printf("#include \"traduzido.h\"\n");
+
+  int n_blocos = 0;
+  for (int end = carga; end < carga + tamanho; end++) {
+    int fim;
+    if (eh_lider[end - carga] && tam_bloco(end, &fim) > 0) {
+      gera_bloco(end);
+      n_blocos++;
+    }
+  }
+
+  printf("\nstatic int executa(trad_estado_t *e, int n)\n{\n");
+  printf("  int feitas = 0;\n");
+  printf("  for (;;) {\n");
+  printf("    int tam, k;\n");
+  printf("    switch (e->PC) {\n");
+  for (int end = carga; end < carga + tamanho; end++) {
+    int fim;
+    int n;
+    if (eh_lider[end - carga] && (n = tam_bloco(end, &fim)) > 0) {
+      printf("      case %d: TRAD_BLOCO(bloco_%04d, %d);\n", end, end, n);
+    }
+  }
+  printf("      default: return feitas;\n");
+  printf("    }\n");
+  printf("    feitas += k;\n");
+  printf("    if (k < tam || e->erro != ERR_OK || e->prog->alterado) {\n");
+  printf("      return feitas;\n");
+  printf("    }\n");
+  printf("  }\n");
+  printf("}\n");
+
+  printf("\nstatic const int imagem[%d] = {", tamanho);
+  for (int i = 0; i < tamanho; i++) {
+    if (i % 10 == 0) printf("\n ");
+    printf(" %d,", prog_dado(prog, carga + i));
+  }
+  printf("\n};\n");
+  gera_tabela("eh_codigo", eh_codigo);
+
+  printf("\ntrad_programa_t trad_%s = {\n", ident);
+  printf("  .nome = \"%s\",\n", barra != NULL ? barra + 1 : nome);
+  printf("  .carga = %d,\n", carga);
+  printf("  .tamanho = %d,\n", tamanho);
+  printf("  .imagem = imagem,\n");
+  printf("  .eh_codigo = eh_codigo,\n");
+  printf("  .executa = executa,\n");
+  printf("};\n");
+  fprintf(stderr, "%s: %d blocos\n", nome, n_blocos);
+}
+
+void traduz(char *nome)
+{
+  prog = prog_cria(nome);
+  if (prog == NULL) {
+    fprintf(stderr, "ERRO: não foi possível ler o programa '%s'\n", nome);
+    exit(1);
+  }
+  carga = prog_end_carga(prog);
+  tamanho = prog_tamanho(prog);
+  encontra_blocos();
+  gera_programa(nome);
+  prog_destroi(prog);
+}
+
+void gera_lista(int n, char *nomes[n])
+{
+  char ident[100];
+  printf("// programas traduzidos ligados ao simulador, gerado pelo tradutor"
+         " -- não altere\n\n");
+  printf("#include \"traduzido.h\"\n\n");
+  for (int i = 0; i < n; i++) {
+    identificador(nomes[i], ident);
+    printf("extern trad_programa_t trad_%s;\n", ident);
+  }
+  printf("\ntrad_programa_t *trad_programas[] = {\n");
+  for (int i = 0; i < n; i++) {
+    identificador(nomes[i], ident);
+    printf("  &trad_%s,\n", ident);
+  }
+  printf("  NULL\n};\n");
+}
+
+int main(int argc, char *argv[argc])
+{
+  if (argc >= 2 && strcmp(argv[1], "-t") == 0) {
+    gera_lista(argc - 2, &argv[2]);
+    return 0;
+  }
+  if (argc != 2) {
+    fprintf(stderr, "ERRO: chame como '%s nome_do_arquivo.maq' ou "
+                    "'%s -t nome_do_arquivo.maq ...'\n", argv[0], argv[0]);
+    exit(1);
+  }
+  traduz(argv[1]);
+  return 0;
+}
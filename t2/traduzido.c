@@ -0,0 +1,70 @@
+#include "traduzido.h"
+
+#include <string.h>
+
+trad_programa_t *trad_acha(char *nome, programa_t *prog)
+{
+  for (int i = 0; trad_programas[i] != NULL; i++) {
+    trad_programa_t *trad = trad_programas[i];
+    if (strcmp(trad->nome, nome) != 0) continue;
+    if (trad->carga != prog_end_carga(prog)) continue;
+    if (trad->tamanho != prog_tamanho(prog)) continue;
+    bool igual = true;
+    for (int end = 0; end < trad->tamanho && igual; end++) {
+      igual = trad->imagem[end] == prog_dado(prog, trad->carga + end);
+    }
+    if (igual) return trad;
+  }
+  return NULL;
+}
+
+void trad_nota_escrita(trad_programa_t *self, int end)
+{
+  int pos = end - self->carga;
+  if (pos >= 0 && pos < self->tamanho && self->eh_codigo[pos]) {
+    self->alterado = true;
+  }
+}
+
+bool trad_busca(trad_estado_t *estado, int end, int tam, int *ppag)
+{
+  // o interpretador traduz o endereço do opcode para execução, e também o
+  //   do argumento, se ele estiver na página seguinte
+  int endfis;
+  if (PAGINA_DO_END(end) != *ppag) {
+    if (mmu_traduz(estado->mmu, end, &endfis, usuario, PAG_EXECUCAO)
+        != ERR_OK) {
+      return false;
+    }
+    *ppag = PAGINA_DO_END(end);
+  }
+  if (tam > 1 && PAGINA_DO_END(end + 1) != *ppag) {
+    estado->erro = mmu_traduz(estado->mmu, end + 1, &endfis, usuario,
+                              PAG_EXECUCAO);
+    if (estado->erro != ERR_OK) {
+      estado->complemento = end + 1;
+      return false;
+    }
+    *ppag = PAGINA_DO_END(end + 1);
+  }
+  return true;
+}
+
+bool trad_le(trad_estado_t *estado, int end, int *pvalor)
+{
+  estado->erro = mmu_le(estado->mmu, end, pvalor, usuario);
+  if (estado->erro == ERR_OK) return true;
+  estado->complemento = end;
+  return false;
+}
+
+bool trad_escreve(trad_estado_t *estado, int end, int valor)
+{
+  estado->erro = mmu_escreve(estado->mmu, end, valor, usuario);
+  if (estado->erro != ERR_OK) {
+    estado->complemento = end;
+    return false;
+  }
+  trad_nota_escrita(estado->prog, end);
+  return true;
+}
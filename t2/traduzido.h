@@ -0,0 +1,126 @@
+#ifndef TRADUZIDO_H
+#define TRADUZIDO_H
+
+// programas traduzidos para C antes da execução (pelo tradutor), ligados
+//   ao simulador
+// o tradutor lê um '.maq' e gera um arquivo C com uma função para cada
+//   bloco básico do programa e uma função que despacha os blocos conforme
+//   o PC; a CPU chama essa função no lugar de interpretar as instruções
+//   quando está executando em modo usuário um processo que carregou o
+//   programa (ver cpu_associa_traduzido)
+// o código traduzido acessa a memória pela MMU, com o mesmo tratamento de
+//   erros do interpretador, e para (deixando para o interpretador) quando
+//   não dá para continuar igual a ele
+// se o processo alterar alguma posição de memória que contém código
+//   traduzido, o programa traduzido deixa de ser usado
+
+#include "err.h"
+#include "mmu.h"
+#include "programa.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct trad_programa_t trad_programa_t;
+
+// estado da CPU visto pelo código traduzido
+typedef struct {
+  int PC;
+  int A;
+  int X;
+  err_t erro;
+  int complemento;
+  mmu_t *mmu;
+  trad_programa_t *prog;
+} trad_estado_t;
+
+// executa blocos traduzidos a partir do PC em 'estado', no máximo 'n'
+//   instruções
+// retorna o número de instruções executadas (0 se não há bloco traduzido
+//   no PC, ou se ele tem mais de 'n' instruções), incluindo a que causou
+//   erro, se for o caso (com erro e complemento em 'estado')
+typedef int (*trad_executa_t)(trad_estado_t *estado, int n);
+
+// um programa traduzido
+struct trad_programa_t {
+  char *nome;                     // nome do '.maq' que foi traduzido
+  int carga;                      // endereço de carga
+  int tamanho;                    // número de palavras
+  const int *imagem;              // conteúdo do '.maq'
+  const unsigned char *eh_codigo; // se cada palavra é coberta por um bloco
+  trad_executa_t executa;
+  bool alterado;                  // se algum processo alterou o código
+  long n_instr;                   // instruções executadas pelo código traduzido
+};
+
+// programas traduzidos ligados ao simulador, terminado por NULL
+// (gerado pelo tradutor, em traduzidos.c)
+extern trad_programa_t *trad_programas[];
+
+// retorna o programa traduzido de nome 'nome' cujo conteúdo é igual ao de
+//   'prog', ou NULL se não houver
+trad_programa_t *trad_acha(char *nome, programa_t *prog);
+
+// informa que o processo que executa o programa escreveu no endereço
+//   virtual 'end'; se for código traduzido, o programa deixa de ser usado
+void trad_nota_escrita(trad_programa_t *self, int end);
+
+
+// funções e macros usadas pelo código gerado pelo tradutor
+// cada bloco mantém A e X em variáveis locais, e 'pag' é a última página
+//   de onde o bloco buscou instrução
+
+// verifica se o interpretador conseguiria buscar a instrução de 'tam'
+//   palavras em 'end', marcando as páginas como acessadas como ele faria
+// retorna false se não (se o erro foi no argumento, está em 'estado')
+bool trad_busca(trad_estado_t *estado, int end, int tam, int *ppag);
+
+// lê o valor no endereço virtual 'end'
+// retorna false em caso de erro, com erro e complemento em 'estado'
+bool trad_le(trad_estado_t *estado, int end, int *pvalor);
+
+// escreve 'valor' no endereço virtual 'end'
+// retorna false em caso de erro, com erro e complemento em 'estado'
+// marca o programa como alterado se 'end' contém código traduzido
+bool trad_escreve(trad_estado_t *estado, int end, int valor);
+
+// início de um bloco
+#define TRAD_INICIO int A = e->A, X = e->X, pag = -1, v; (void)v
+
+// sai do bloco com PC em 'pc', depois de executar 'n' instruções
+#define TRAD_SAI(pc, n) do {                                              \
+    e->A = A;                                                             \
+    e->X = X;                                                             \
+    e->PC = (pc);                                                         \
+    return (n);                                                           \
+  } while (false)
+
+// busca a instrução de 'tam' palavras em 'end', a 'k'-ésima do bloco
+//   (a partir de 0); se não conseguir, sai sem executar a instrução, ou
+//   com erro, se foi no argumento
+#define TRAD_BUSCA(end, tam, k)                                           \
+  if ((PAGINA_DO_END(end) != pag                                          \
+       || ((tam) > 1 && PAGINA_DO_END((end) + 1) != pag))                 \
+      && !trad_busca(e, end, tam, &pag)) {                                \
+    TRAD_SAI(end, e->erro == ERR_OK ? (k) : (k) + 1);                     \
+  }
+
+// lê de 'end' para 'dest' / escreve 'val' em 'end', na instrução em 'pc',
+//   a 'k'-ésima do bloco; em caso de erro, sai com a instrução executada
+//   (e o erro em 'e')
+#define TRAD_LE(end, dest, pc, k)                                         \
+  if (!trad_le(e, end, &(dest))) TRAD_SAI(pc, (k) + 1)
+#define TRAD_ESCREVE(end, val, pc, k)                                     \
+  if (!trad_escreve(e, end, val)) TRAD_SAI(pc, (k) + 1)
+
+// depois de uma escrita: se ela alterou o código, sai com PC em 'pc_seg'
+#define TRAD_VERIFICA_ALTERADO(pc_seg, k)                                 \
+  if (e->prog->alterado) TRAD_SAI(pc_seg, (k) + 1)
+
+// entrada do despacho para o bloco 'bloco', de 'n_instr' instruções
+#define TRAD_BLOCO(bloco, n_instr)                                        \
+  if (n - feitas < (n_instr)) return feitas;                              \
+  tam = (n_instr);                                                        \
+  k = bloco(e);                                                           \
+  break
+
+#endif // TRADUZIDO_H
@@ -0,0 +1,8 @@
+// programas traduzidos ligados ao simulador, gerado pelo tradutor -- não altere
+
+#include "traduzido.h"
+
+
+trad_programa_t *trad_programas[] = {
+  NULL
+};